@@ -23,8 +23,24 @@ LOCAL_SRC_FILES := ndk_interface.cpp \
                    $(PROJECT_ROOT_PATH)/common/RenderLight.cpp \
                    $(PROJECT_ROOT_PATH)/common/transform.cpp \
                    $(PROJECT_ROOT_PATH)/common/glsl_helper.cpp \
+                   $(PROJECT_ROOT_PATH)/common/UniformBuffers.cpp \
+                   $(PROJECT_ROOT_PATH)/common/RenderState.cpp \
+                   $(PROJECT_ROOT_PATH)/common/RenderQueue.cpp \
+                   $(PROJECT_ROOT_PATH)/common/InstanceTransforms.cpp \
+                   $(PROJECT_ROOT_PATH)/common/Frustum.cpp \
+                   $(PROJECT_ROOT_PATH)/common/MeshChunks.cpp \
+                   $(PROJECT_ROOT_PATH)/common/TiledLighting.cpp \
+                   $(PROJECT_ROOT_PATH)/common/DynamicResolution.cpp \
                    $(PROJECT_ROOT_PATH)/common/obj_parser.cpp \
+                   $(PROJECT_ROOT_PATH)/common/mesh_format.cpp \
+                   $(PROJECT_ROOT_PATH)/common/ThreadPool.cpp \
+                   $(PROJECT_ROOT_PATH)/common/AssetLoader.cpp \
+                   $(PROJECT_ROOT_PATH)/common/ResourceCache.cpp \
+                   $(PROJECT_ROOT_PATH)/common/Profiler.cpp \
                    $(PROJECT_ROOT_PATH)/common/RenderDestructible.cpp \
+                   $(PROJECT_ROOT_PATH)/common/RenderDestructibleDraw.cpp \
+                   $(PROJECT_ROOT_PATH)/common/Fluid.cpp \
+                   $(PROJECT_ROOT_PATH)/common/FluidDraw.cpp \
                    $(PROJECT_ROOT_PATH)/common/HUD.cpp
                    
 LOCAL_LDLIBS    := -llog \
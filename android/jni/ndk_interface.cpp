@@ -10,6 +10,10 @@
 static JavaVM * javaVM;
 static jobject callbackObject;
 
+// Looked up once on a Java thread: FindClass can't see app classes from
+// native threads (the asset loader's workers), which use the system loader.
+static jclass callbackClass;
+
 jint JNI_OnLoad(JavaVM * vm, void * unused) {
     LOGI("JNI_OnLoad called");
     javaVM = vm;
@@ -48,7 +52,7 @@ void * resourcecb(const char * fileName, int * width, int * height) {
         isAttached = 1;
     }
 
-    jclass cls = env->FindClass("edu/stanford/nativegraphics/NativeLib");
+    jclass cls = callbackClass;
     if(!cls) {
         if(isAttached)
             javaVM->DetachCurrentThread();
@@ -105,11 +109,53 @@ void * resourcecb(const char * fileName, int * width, int * height) {
     
 }
 
+void * binaryresourcecb(const char * fileName, int * size) {
+    int status;
+    JNIEnv *env;
+    int isAttached = 0;
+
+    if(!callbackObject)
+    	return NULL;
+
+    if((status = javaVM->GetEnv((void**)&env, JNI_VERSION_1_6)) < 0) {
+        if((status = javaVM->AttachCurrentThread(&env, NULL)) < 0)
+            return NULL;
+        isAttached = 1;
+    }
+
+    jclass cls = callbackClass;
+    jmethodID method = cls ? env->GetMethodID(cls, "binaryCallback", "(Ljava/lang/String;)[B") : NULL;
+    if(!method) {
+        if(isAttached)
+            javaVM->DetachCurrentThread();
+        return NULL;
+    }
+
+    jstring jfileName = env->NewStringUTF(fileName);
+    jbyteArray jfile = (jbyteArray) env->CallObjectMethod(callbackObject, method, jfileName);
+    void * returnFile = NULL;
+    if(jfile != NULL) {
+        *size = env->GetArrayLength(jfile);
+        returnFile = malloc(*size);
+        env->GetByteArrayRegion(jfile, 0, *size, (jbyte *) returnFile);
+    }
+
+    if(isAttached)
+        javaVM->DetachCurrentThread();
+    return returnFile;
+}
+
+void releasebinaryresourcecb(void * data, int size) {
+    free(data);
+}
+
 extern "C"
 JNIEXPORT void JNICALL Java_edu_stanford_nativegraphics_NativeLib_init(JNIEnv * env, jobject obj, jint w, jint h) {
     LOGI("Native Setup() called.");
     callbackObject = env->NewGlobalRef(obj);
+    callbackClass = (jclass) env->NewGlobalRef(env->FindClass("edu/stanford/nativegraphics/NativeLib"));
     SetResourceCallback(resourcecb);
+    SetBinaryResourceCallback(binaryresourcecb, releasebinaryresourcecb);
     Setup(w, h);
 }
 
@@ -26,6 +26,15 @@ public class NativeLib {
         return RawResourceReader.readTextFileFromRawResource(mContext, resID);
     }
     
+    // Called from native
+    public byte[] binaryCallback(String fileName) {
+    	String splitName = fileName.split("\\.")[0];
+    	int resID = mContext.getResources().getIdentifier(splitName, "raw", "edu.stanford.nativegraphics");
+    	if(resID == 0)
+    		return null;
+        return RawResourceReader.readBinaryFileFromRawResource(mContext, resID);
+    }
+    
     // Called from native
 	public Bitmap drawableCallback(String fileName) {
     	String splitName = fileName.split("\\.")[0];
@@ -1,6 +1,7 @@
 package edu.stanford.nativegraphics;
 
 import java.io.BufferedReader;
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.InputStreamReader;
@@ -28,4 +29,21 @@ public class RawResourceReader {
 
 		return body.toString();
 	}
+	
+	public static byte[] readBinaryFileFromRawResource(final Context context, final int resourceId) {
+		final InputStream inputStream = context.getResources().openRawResource(resourceId);
+		final ByteArrayOutputStream body = new ByteArrayOutputStream();
+		final byte[] buffer = new byte[16384];
+
+		try {
+			int length;
+			while ((length = inputStream.read(buffer)) != -1)
+				body.write(buffer, 0, length);
+			inputStream.close();
+		} catch (IOException e) {
+			return null;
+		}
+
+		return body.toByteArray();
+	}
 }
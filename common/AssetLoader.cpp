@@ -0,0 +1,178 @@
+// AssetLoader.cpp
+// nativeGraphics
+// Background loading of meshes and textures, uploaded to GL on the render thread
+
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "RenderObject.h"
+#include "ThreadPool.h"
+#include "obj_parser.h"
+#include "mesh_format.h"
+#include "Frustum.h"
+#include "common.h"
+#include "log.h"
+#include "Timer.h"
+
+AssetRequest::AssetRequest(Type type, const char * fileName, RenderObject * target)
+    : type(type), fileName(fileName), normalMap(false), target(target), loader(NULL),
+      vertexBuffer(NULL), indices(NULL), indexSize(0), numVertices(0), numIndices(0),
+      meshFile(NULL), meshFileSize(0), cacheEntry(NULL), sortedIndices(NULL), imageData(NULL), width(0), height(0) {
+    bounds[0] = bounds[1] = bounds[2] = 0.0f;
+    bounds[3] = -1.0f;
+}
+
+void AssetLoader::Request(AssetRequest * request) {
+    request->loader = this;
+    request->target->pendingAssets++;
+    pending.push_back(request);
+    ThreadPool::Shared()->Submit(LoadTask, request);
+}
+
+void AssetLoader::Cancel(RenderObject * target) {
+    for(int i = 0; i < pending.size(); i++) {
+        if(pending[i]->target == target)
+            pending[i]->target = NULL;
+    }
+}
+
+void AssetLoader::Update(float budget) {
+    Timer timer;
+    bool uploaded = false;
+    AssetRequest * request;
+    while(loaded.Pop(request)) {
+        uploaded = true;
+        pending.erase(std::find(pending.begin(), pending.end(), request));
+        if(request->target != NULL) {
+            Upload(request);
+            request->target->pendingAssets--;
+        }
+        Free(request);
+        delete request;
+
+        if(timer.getSeconds() >= budget)
+            break;
+    }
+
+    if(uploaded && pending.empty() && resourceCache) {
+        LOGI("Assets loaded, resource cache: %d hits, %d misses", resourceCache->Hits(), resourceCache->Misses());
+    }
+}
+
+void AssetLoader::LoadNow(AssetRequest * request) {
+    Load(request);
+    Upload(request);
+    Free(request);
+    delete request;
+}
+
+void AssetLoader::LoadTask(void * arg) {
+    AssetRequest * request = (AssetRequest *) arg;
+    Load(request);
+    request->loader->loaded.Push(request);
+}
+
+// Runs on a worker thread, so must not touch GL or the target.
+void AssetLoader::Load(AssetRequest * request) {
+    const char * fileName = request->fileName.c_str();
+
+    if(request->type == AssetRequest::TEXTURE) {
+        if(resourceCache) {
+            const void * pixels;
+            request->cacheEntry = resourceCache->LoadTexture(fileName, pixels, request->width, request->height);
+            request->imageData = (void *) pixels;
+            if(request->cacheEntry != NULL)
+                return;
+        }
+        request->imageData = loadResource(fileName, &request->width, &request->height);
+        if(request->imageData == NULL) {
+            LOGE("Unable to load texture %s", fileName);
+        } else if(resourceCache) {
+            resourceCache->StoreTexture(fileName, request->imageData, request->width, request->height);
+        }
+        return;
+    }
+
+    LoadMesh(request);
+    if(request->vertexBuffer == NULL)
+        return;
+    boundingSphere(request->vertexBuffer, request->numVertices, 3+3+2, request->bounds);
+
+    // Split big meshes up, so the parts out of view can be skipped
+    if(request->numIndices >= 3 * MESH_CHUNK_TRIANGLES * MESH_CHUNK_MIN_CHUNKS) {
+        request->sortedIndices = malloc(request->numIndices * request->indexSize);
+        if(!buildMeshChunks(request->vertexBuffer, 3+3+2, request->indices, request->indexSize, request->numIndices,
+                            request->sortedIndices, request->chunks)) {
+            free(request->sortedIndices);
+            request->sortedIndices = NULL;
+        }
+    }
+}
+
+void AssetLoader::LoadMesh(AssetRequest * request) {
+    const char * fileName = request->fileName.c_str();
+
+    // Use the precompiled mesh directly if there is an up-to-date one
+    int floatsPerVertex = 0;
+    request->meshFile = loadBinaryResource(meshFileName(fileName).c_str(), &request->meshFileSize);
+    request->vertexBuffer = (GLfloat *) readMeshFile(request->meshFile, request->meshFileSize, request->numVertices, floatsPerVertex, request->indices, request->numIndices, request->indexSize);
+    if(request->vertexBuffer != NULL && floatsPerVertex == 3+3+2)
+        return;
+    if(request->meshFile != NULL) {
+        releaseBinaryResource(request->meshFile, request->meshFileSize);
+        request->meshFile = NULL;
+    }
+
+    if(resourceCache) {
+        const float * vertices;
+        request->cacheEntry = resourceCache->LoadMesh(fileName, vertices, request->numVertices, request->indices, request->numIndices, request->indexSize);
+        request->vertexBuffer = (GLfloat *) vertices;
+        if(request->cacheEntry != NULL)
+            return;
+    }
+
+    // Parse obj file into an indexed, interleaved float buffer
+    unsigned int * indices;
+    request->vertexBuffer = getIndexedBuffer((char *)loadResource(fileName), request->numVertices, indices, request->numIndices, true, true);
+    if(resourceCache)
+        resourceCache->StoreMesh(fileName, request->vertexBuffer, request->numVertices, indices, request->numIndices);
+    if(request->numVertices <= 65536) {
+        GLushort * shortIndices = (GLushort *) malloc(request->numIndices * sizeof(GLushort));
+        std::copy(indices, indices + request->numIndices, shortIndices);
+        free(indices);
+        request->indices = shortIndices;
+        request->indexSize = sizeof(GLushort);
+    } else {
+        request->indices = indices;
+        request->indexSize = sizeof(GLuint);
+    }
+}
+
+void AssetLoader::Upload(AssetRequest * request) {
+    RenderObject * target = request->target;
+    if(request->type == AssetRequest::TEXTURE) {
+        target->UploadTexture((GLubyte *) request->imageData, request->width, request->height, request->normalMap);
+    } else {
+        target->numVertices = request->numVertices;
+        target->numIndices = request->numIndices;
+        for(int i = 0; i < 4; i++)
+            target->bounds[i] = request->bounds[i];
+        target->chunks = request->chunks;
+        target->UploadMesh(request->vertexBuffer, request->sortedIndices ? request->sortedIndices : request->indices, request->indexSize);
+    }
+}
+
+void AssetLoader::Free(AssetRequest * request) {
+    if(request->meshFile != NULL) {
+        releaseBinaryResource(request->meshFile, request->meshFileSize);
+    } else if(request->cacheEntry != NULL) {
+        free(request->cacheEntry);
+    } else {
+        free(request->vertexBuffer);
+        free((void *) request->indices);
+    }
+    free(request->sortedIndices);
+    //free(request->imageData); // TODO: Not allowed on Samsung Galaxy (not malloc'd).
+}
@@ -0,0 +1,77 @@
+// AssetLoader.h
+// nativeGraphics
+// Background loading of meshes and textures, uploaded to GL on the render thread
+
+#ifndef __nativeGraphics__AssetLoader__
+#define __nativeGraphics__AssetLoader__
+
+#include <string>
+#include <vector>
+
+#include "graphics_header.h"
+#include "LockFreeQueue.h"
+#include "MeshChunks.h"
+
+class RenderObject;
+class AssetLoader;
+
+struct AssetRequest {
+    enum Type { MESH, TEXTURE };
+
+    AssetRequest(Type type, const char * fileName, RenderObject * target);
+
+    Type type;
+    std::string fileName;
+    bool normalMap;
+    RenderObject * target; // NULL once cancelled; only touched on the render thread
+    AssetLoader * loader;
+
+    // CPU-side payload, filled in by Load()
+    GLfloat * vertexBuffer;
+    const void * indices;
+    int indexSize;
+    int numVertices;
+    int numIndices;
+    void * meshFile; // Precompiled mesh that vertexBuffer and indices point into
+    int meshFileSize;
+    void * cacheEntry; // Resource cache entry that the payload points into
+    float bounds[4]; // Bounding sphere of the mesh: center x, y, z and radius
+    std::vector<MeshChunk> chunks; // Empty unless the mesh was split up
+    void * sortedIndices; // The indices in chunk order, if it was
+
+    void * imageData;
+    int width;
+    int height;
+};
+
+// Lives for the whole program, since workers hold on to it while loading.
+class AssetLoader {
+public:
+    // Reads and decodes the request's file on a worker thread. The target is
+    // updated from Update() once the payload is ready.
+    void Request(AssetRequest * request);
+
+    // Drops any outstanding requests for target, which is about to be deleted.
+    void Cancel(RenderObject * target);
+
+    // Uploads finished payloads to GL until budget seconds have passed (at
+    // least one upload is always made). Call once a frame on the GL thread.
+    void Update(float budget);
+
+    int NumPending() const { return pending.size(); }
+
+    // Loads and uploads on the calling thread, for use without a loader.
+    static void LoadNow(AssetRequest * request);
+
+private:
+    static void Load(AssetRequest * request);
+    static void LoadMesh(AssetRequest * request);
+    static void Upload(AssetRequest * request);
+    static void Free(AssetRequest * request);
+    static void LoadTask(void * request);
+
+    LockFreeQueue<AssetRequest *> loaded;
+    std::vector<AssetRequest *> pending; // Requested, not yet uploaded
+};
+
+#endif // __nativeGraphics__AssetLoader__
@@ -2,6 +2,8 @@
 
 #include "Eigen/Core"
 
+using Eigen::Vector3f;
+
 #define CELL_WIDTH 1.f
 #define SOURCE 0
 #define FLUID 1
@@ -52,7 +54,7 @@ typedef struct {
  Return the point between two points in the same ratio as
  isolevel is between valp1 and valp2
  */
-XYZ VertexInterp(double isolevel,XYZ p1,XYZ p2,double valp1,double valp2)
+static XYZ VertexInterp(double isolevel,XYZ p1,XYZ p2,double valp1,double valp2)
 {
     double mu;
     XYZ p;
@@ -79,7 +81,7 @@ XYZ VertexInterp(double isolevel,XYZ p1,XYZ p2,double valp1,double valp2)
  0 will be returned if the grid cell is either totally above
  of totally below the isolevel.
  */
-int PolygoniseCube(GRIDCELL g,double iso,TRIANGLE *tri)
+static int PolygoniseCube(GRIDCELL g,double iso,TRIANGLE *tri)
 {
     int i,ntri = 0;
     int cubeindex;
@@ -24,18 +24,20 @@ using Eigen::Vector4f;
 Character::Character(const char *objFilename, const char *vertexShaderFilename, const char *fragmentShaderFilename, bool collide)
                                                   : RenderObject(objFilename, vertexShaderFilename, fragmentShaderFilename, true) {
     this->collide = collide;
+    if(!vertexShaderFilename)
+        EnableInstancing(fragmentShaderFilename);
 }
 
 static inline float clamp(float x, float a, float b) {
     return x < a ? a : (x > b ? b : x);
 }
 
-void Character::Update() {
+void Character::Update(float dt) {
     for(int i = 0; i < instances.size(); i++)
-        Update(i);
+        Update(i, dt);
 }
 
-void Character::Update(int instanceNum) {
+void Character::Update(int instanceNum, float timeElapsed) {
     if(instanceNum >= instances.size()) {
         LOGE("Character::Update: Out of bounds exception.");
         return;
@@ -43,9 +45,8 @@ void Character::Update(int instanceNum) {
 
     struct characterInstance * instance = &instances[instanceNum];
 
-    float timeElapsed = instance->lastUpdate.getSeconds();
-    instance->lastUpdate.reset();
-    
+    instance->previousPosition = instance->position;
+
     // Accelerate towards target
     if(instance->targetPosition != instance->position) {
         Vector3f targetVector = instance->targetPosition - instance->position;
@@ -86,3 +87,19 @@ void Character::RenderPass(int instance) {
     RenderObject::RenderPass(instance, 0, -1);
 }
 
+void Character::SubmitAll(float alpha, const Matrix4f & local) {
+    placements.Clear();
+    drawnInstances.clear();
+    for(int i = 0; i < instances.size(); i++) {
+        placements.Add(instances[i].RenderPosition(alpha), instances[i].rot[0], instances[i].rot[1],
+                       instances[i].scale, instances[i].animationTime);
+        drawnInstances.push_back(i);
+    }
+    if(cull)
+        placements.Cull(local, bounds, drawnInstances);
+    if(drawnInstances.empty())
+        return;
+
+    placements.Build(local, AddInstances(&drawnInstances[0], drawnInstances.size()));
+    SubmitInstances();
+}
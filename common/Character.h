@@ -9,11 +9,12 @@
 #include <vector>
 
 #include "RenderObject.h"
-#include "Timer.h"
+#include "InstanceTransforms.h"
 
 #include "Eigen/Core"
 
 using Eigen::Vector3f;
+using Eigen::Matrix4f;
 
 using namespace std;
 
@@ -30,32 +31,49 @@ struct characterInstance {
         MaxAcceleration = 660.0f;
         Drag = 550.0f;
         position = Vector3f(0, 0, 0);
+        previousPosition = Vector3f(0, 0, 0);
         velocity = Vector3f(0, 0, 0);
         rot[0] = 0;
         rot[1] = 0;
-        lastUpdate.reset();
+        scale = 1.0f;
         animationTime = 0.0f;
     }
 
+    // Moves without interpolating from the old position.
+    void Teleport(const Vector3f & p) {
+        position = previousPosition = p;
+    }
+
+    // Position between the last two simulation steps.
+    Vector3f RenderPosition(float alpha) const {
+        return previousPosition + alpha * (position - previousPosition);
+    }
+
     Vector3f targetPosition;
     float MaxVelocity;
     float MaxAcceleration;
     float Drag;
 
     Vector3f position;
+    Vector3f previousPosition;
     Vector3f velocity;
     float rot[2];
+    float scale; // Of the model, when drawn
 
-    Timer lastUpdate;
     float animationTime;
 };
 
 class Character : public RenderObject {
 public:
     Character(const char *objFile, const char *vertexShaderFile, const char *fragmentShaderFile, bool collisions = false);
-    void Update(); // Update all instances
-    void Update(int instance); // Update a specific instance
+    void Update(float dt); // Update all instances
+    void Update(int instance, float dt); // Update a specific instance
     void RenderPass(int instance);
+
+    // Queues every instance for one instanced draw, at its position between
+    // the last two steps and facing the way it moves. local is applied
+    // first, e.g. to orient or scale the model.
+    void SubmitAll(float alpha, const Matrix4f & local);
     /*void ReplaceModel(); //should only be used for sub, replaces sub with destructible model
     void DestructibleRender();
     void DestructibleRenderPass();
@@ -63,6 +81,11 @@ public:
     vector<struct characterInstance> instances;
 
     bool collide;
+
+private:
+    // Scratch space for SubmitAll, kept to reuse its storage
+    InstanceTransforms placements;
+    vector<int> drawnInstances;
 };
 
 
@@ -0,0 +1,63 @@
+// DynamicResolution.cpp
+// nativeGraphics
+// Adjusts the render scale from measured frame times, to hold a target frame rate
+
+#include "DynamicResolution.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "RenderPipeline.h"
+#include "Timer.h"
+#include "log.h"
+
+DynamicResolution dynamicResolution;
+
+DynamicResolution::DynamicResolution() : targetFrameTime(0.0), lastFrame(0.0), average(-1.0), frames(0),
+                                         scale(1.0f), maxScale(1.0f) {
+}
+
+void DynamicResolution::Init(float targetFrameRate, float maxScale) {
+    targetFrameTime = targetFrameRate > 0.0f ? 1.0 / targetFrameRate : 0.0;
+    this->maxScale = maxScale;
+    scale = maxScale;
+    average = -1.0;
+    frames = 0;
+    if(IsEnabled()) {
+        LOGI("Adjusting render scale for %.0f frames per second", targetFrameRate);
+    }
+}
+
+bool DynamicResolution::Update() {
+    if(!IsEnabled())
+        return false;
+
+    double now = monotonicSeconds();
+    double frameTime = now - lastFrame;
+    lastFrame = now;
+    // The first frame has nothing to measure from, and the first after a
+    // change includes reallocating the buffers
+    if(frames++ < 2)
+        return false;
+    average = average < 0.0 ? frameTime : average + DYNAMIC_RESOLUTION_SMOOTHING * (frameTime - average);
+    if(frames < DYNAMIC_RESOLUTION_SETTLE_FRAMES)
+        return false;
+
+    float wanted = scale;
+    if(average > 1.05 * targetFrameTime) {
+        // Rounded down, so it drops by at least a step
+        wanted = scale * sqrtf(targetFrameTime / average);
+        wanted = floorf(wanted / DYNAMIC_RESOLUTION_STEP + .01f) * DYNAMIC_RESOLUTION_STEP;
+    } else if(average < .8 * targetFrameTime) {
+        wanted = scale + DYNAMIC_RESOLUTION_STEP;
+    }
+    wanted = std::min(maxScale, std::max(RENDER_SCALE_MIN, wanted));
+    if(fabsf(wanted - scale) < .5f * DYNAMIC_RESOLUTION_STEP)
+        return false;
+
+    LOGI("Render scale %.2f, after %.1f ms frames at %.2f", wanted, 1000.0 * average, scale);
+    scale = wanted;
+    average = -1.0;
+    frames = 1;
+    return true;
+}
@@ -0,0 +1,47 @@
+// DynamicResolution.h
+// nativeGraphics
+// Adjusts the render scale from measured frame times, to hold a target frame rate
+
+#ifndef __nativeGraphics__DynamicResolution__
+#define __nativeGraphics__DynamicResolution__
+
+// Scales are kept to multiples of this, so the buffers aren't reallocated
+// for every small change
+#define DYNAMIC_RESOLUTION_STEP .05f
+// Frames measured at a new scale before it can change again
+#define DYNAMIC_RESOLUTION_SETTLE_FRAMES 30
+// Weight of each frame in the running average frame time
+#define DYNAMIC_RESOLUTION_SMOOTHING .1f
+
+// Frame times are measured between calls to Update, so they include
+// everything the platform does between frames. When the average runs over
+// the target, the scale drops by the square root of the overrun, since the
+// g buffer and lights cost about as much as their pixel count. When it's
+// well under, the scale climbs back a step at a time. Under vsync frames
+// never measure faster than the refresh rate, so a target a little below
+// that leaves room to climb.
+class DynamicResolution {
+public:
+    DynamicResolution();
+
+    // Starts at maxScale, and never goes above it. A targetFrameRate of 0
+    // leaves the scale alone.
+    void Init(float targetFrameRate, float maxScale);
+    bool IsEnabled() const { return targetFrameTime > 0.0; }
+
+    // Call once a frame. True if Scale changed.
+    bool Update();
+    float Scale() const { return scale; }
+
+private:
+    double targetFrameTime; // Seconds
+    double lastFrame; // monotonicSeconds() at the last Update
+    double average; // Seconds per frame, or negative until measured
+    int frames; // Updates since the scale last changed
+    float scale;
+    float maxScale;
+};
+
+extern DynamicResolution dynamicResolution;
+
+#endif // __nativeGraphics__DynamicResolution__
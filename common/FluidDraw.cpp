@@ -0,0 +1,61 @@
+//  FluidDraw.cpp
+//  nativeGraphics
+//  The GL side of Fluid, kept apart from the simulation in Fluid.cpp so
+//  the benchmark can link that without GL.
+
+#include "Fluid.h"
+#include "transform.h"
+#include "UniformBuffers.h"
+#include "RenderState.h"
+#include "log.h"
+
+Fluid::Fluid(const char *vertexShaderFilename, const char *fragmentShaderFilename)
+           : RenderObject(vertexShaderFilename, fragmentShaderFilename, true) {
+    Init();
+}
+
+// Overrides RenderObject::Render
+void Fluid::Execute(const DrawPacket & packet) {
+    Render(0, 0, 0);
+}
+
+void Fluid::Render(float rx, float ry, float rz) {
+
+    // In bound
+    int inBoundCount = 0;
+    float * mesh = GenVertexArrayInBound(inBoundCount);
+    RenderObject::Render(0, mesh, inBoundCount);
+    delete[] mesh;
+
+    // Out bound
+    int outBoundCount = 0;
+    mesh = GenVertexArrayOutBound(outBoundCount);
+    RenderObject::Render(0, mesh, outBoundCount);
+    delete[] mesh;
+}
+
+// Overrides RenderObject::RenderPass
+void Fluid::RenderPass(int instance, GLfloat *buffer, int num) {
+
+    renderState.Enable(GL_DEPTH_TEST, true);
+
+    // Pass matrices
+    if(uniformBuffers.IsEnabled())
+        uniformBuffers.SetObject();
+    else {
+        glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mvMatrix());
+        glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvpMatrix());
+        checkGlError("glUniformMatrix4fv");
+    }
+    
+    // Don't use vertex buffering
+    renderState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Pass vertices
+    glEnableVertexAttribArray(gvPositionHandle);
+    glVertexAttribPointer(gvPositionHandle, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (const GLvoid*)(0 + buffer));
+    checkGlError("gvPositionHandle");
+    
+    glDrawArrays(GL_POINTS, 0, num);
+    checkGlError("glDrawArrays");
+}
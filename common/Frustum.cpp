@@ -0,0 +1,89 @@
+// Frustum.cpp
+// nativeGraphics
+// Bounding spheres, and testing them against the view frustum
+
+#include "Frustum.h"
+
+#include <math.h>
+
+void Frustum::Extract(const Matrix4f & m) {
+    // Each plane is the last row of the matrix plus or minus another row
+    // (Gribb and Hartmann): -w <= x <= w and so on, in clip space.
+    for(int i = 0; i < 4; i++) {
+        planes[FRUSTUM_LEFT][i] = m(3, i) + m(0, i);
+        planes[FRUSTUM_RIGHT][i] = m(3, i) - m(0, i);
+        planes[FRUSTUM_BOTTOM][i] = m(3, i) + m(1, i);
+        planes[FRUSTUM_TOP][i] = m(3, i) - m(1, i);
+        planes[FRUSTUM_NEAR][i] = m(3, i) + m(2, i);
+        planes[FRUSTUM_FAR][i] = m(3, i) - m(2, i);
+    }
+
+    for(int p = 0; p < FRUSTUM_PLANES; p++) {
+        float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        if(length > 0.0f) {
+            for(int i = 0; i < 4; i++)
+                planes[p][i] /= length;
+        }
+    }
+}
+
+bool Frustum::Intersects(const Vector3f & center, float radius, int numPlanes) const {
+    for(int p = 0; p < numPlanes; p++) {
+        if(planes[p][0] * center[0] + planes[p][1] * center[1] + planes[p][2] * center[2] + planes[p][3] < -radius)
+            return false;
+    }
+    return true;
+}
+
+void boundingSphere(const float * vertices, int numVertices, int floatsPerVertex, float sphere[4]) {
+    if(numVertices <= 0) {
+        sphere[0] = sphere[1] = sphere[2] = sphere[3] = 0.0f;
+        return;
+    }
+
+    // Centered on the bounding box, which is close enough for culling
+    float lower[3], upper[3];
+    for(int i = 0; i < 3; i++)
+        lower[i] = upper[i] = vertices[i];
+    for(int v = 1; v < numVertices; v++) {
+        const float * position = vertices + v * floatsPerVertex;
+        for(int i = 0; i < 3; i++) {
+            if(position[i] < lower[i])
+                lower[i] = position[i];
+            if(position[i] > upper[i])
+                upper[i] = position[i];
+        }
+    }
+    for(int i = 0; i < 3; i++)
+        sphere[i] = .5f * (lower[i] + upper[i]);
+
+    float radiusSquared = 0.0f;
+    for(int v = 0; v < numVertices; v++) {
+        const float * position = vertices + v * floatsPerVertex;
+        float dx = position[0] - sphere[0], dy = position[1] - sphere[1], dz = position[2] - sphere[2];
+        float distanceSquared = dx * dx + dy * dy + dz * dz;
+        if(distanceSquared > radiusSquared)
+            radiusSquared = distanceSquared;
+    }
+    sphere[3] = sqrtf(radiusSquared);
+}
+
+bool screenRect(const Matrix4f & projection, const Vector3f & center, float radius, float rect[4]) {
+    // The rectangle of the sphere's bounding box, which is a little loose
+    // but cheap
+    rect[0] = rect[1] = 1.0f;
+    rect[2] = rect[3] = -1.0f;
+    for(int corner = 0; corner < 8; corner++) {
+        Eigen::Vector4f point(center[0] + (corner & 1 ? radius : -radius),
+                              center[1] + (corner & 2 ? radius : -radius),
+                              center[2] + (corner & 4 ? radius : -radius), 1.0f);
+        Eigen::Vector4f clip = projection * point;
+        if(clip[3] <= 0.0f)
+            return false;
+        for(int i = 0; i < 2; i++) {
+            rect[i] = fminf(rect[i], clip[i] / clip[3]);
+            rect[i + 2] = fmaxf(rect[i + 2], clip[i] / clip[3]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+// Frustum.h
+// nativeGraphics
+// Bounding spheres, and testing them against the view frustum
+
+#ifndef __nativeGraphics__Frustum__
+#define __nativeGraphics__Frustum__
+
+#include "Eigen/Core"
+
+using Eigen::Matrix4f;
+using Eigen::Vector3f;
+
+// Plane order. The side planes come first, so testing only
+// FRUSTUM_SIDE_PLANES of them ignores the depth range.
+#define FRUSTUM_LEFT 0
+#define FRUSTUM_RIGHT 1
+#define FRUSTUM_BOTTOM 2
+#define FRUSTUM_TOP 3
+#define FRUSTUM_NEAR 4
+#define FRUSTUM_FAR 5
+#define FRUSTUM_SIDE_PLANES 4
+#define FRUSTUM_PLANES 6
+
+class Frustum {
+public:
+    // The clip volume of matrix, in the space it transforms from. Given
+    // projection * model-view, that's the current model space.
+    void Extract(const Matrix4f & matrix);
+
+    // False only if the sphere is entirely outside one of the first
+    // numPlanes planes.
+    bool Intersects(const Vector3f & center, float radius, int numPlanes = FRUSTUM_PLANES) const;
+
+    // Planes as (a, b, c, d) with a unit normal pointing inwards, so
+    // a x + b y + c z + d is the signed distance of (x, y, z).
+    float planes[FRUSTUM_PLANES][4];
+};
+
+// Writes a sphere (center x, y, z, then radius) enclosing the positions at
+// the start of each of numVertices vertices of floatsPerVertex floats.
+void boundingSphere(const float * vertices, int numVertices, int floatsPerVertex, float sphere[4]);
+
+// Writes the rectangle (left, bottom, right, top, in normalized device
+// coordinates) that a view-space sphere covers under projection. False if
+// part of the sphere may be behind the eye, so it could cover any of the
+// screen.
+bool screenRect(const Matrix4f & projection, const Vector3f & center, float radius, float rect[4]);
+
+#endif // __nativeGraphics__Frustum__
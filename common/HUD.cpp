@@ -5,6 +5,7 @@
 #include "HUD.h"
 #include "glsl_helper.h"
 #include "transform.h"
+#include "RenderState.h"
 #include "common.h"
 #include "log.h"
 
@@ -14,6 +15,10 @@ HUD::HUD() : RenderObject("square.obj", "overlay_v.glsl", "overlay_f.glsl", fals
     radarTex = AddTexture("radar_back.png");
     greenDotTex = AddTexture("green_dot.png");
     redDotTex = AddTexture("red_dot.png");
+
+    const ShaderLocations & locations = shaderLocations(colorShader);
+    displacementUniform = locations.Uniform("u_displacement");
+    scaleUniform = locations.Uniform("u_scale");
 }
 
 GLuint HUD::AddTexture(const char *textureFilename) {
@@ -23,7 +28,7 @@ GLuint HUD::AddTexture(const char *textureFilename) {
     
     GLuint newTex = -1;
     glGenTextures(1, &newTex);
-    glBindTexture(GL_TEXTURE_2D, newTex);
+    renderState.BindTexture(0, newTex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -32,7 +37,7 @@ GLuint HUD::AddTexture(const char *textureFilename) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderState.BindTexture(0, 0);
     free(imageData); // TODO: Not allowed on Samsung Galaxy (not malloc'd).
     
     checkGlError("AddTexture");
@@ -47,49 +52,53 @@ void HUD::RenderElement(GLuint textureHandle, float xdisp, float ydisp, float xs
         exit(0);
     }
     
-    glUseProgram(colorShader);
-    checkGlError("glUseProgram");
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, defaultFrameBuffer);
-    glViewport(0, 0, displayWidth, displayHeight);
+    renderState.UseProgram(colorShader);
     
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_DITHER);
+    renderState.BindFramebuffer(defaultFrameBuffer);
+    renderState.Viewport(0, 0, displayWidth, displayHeight);
     
-    GLuint u_displacement = glGetUniformLocation(colorShader, "u_displacement");
-    glUniform2f(u_displacement, xdisp, ydisp);
+    renderState.Enable(GL_CULL_FACE, false);
+    renderState.Enable(GL_DEPTH_TEST, false);
+    renderState.Enable(GL_BLEND, true);
+    renderState.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    renderState.Enable(GL_DITHER, false);
     
-    GLuint u_scale = glGetUniformLocation(colorShader, "u_scale");
-    glUniform2f(u_scale, xscale, yscale); 
+    glUniform2f(displacementUniform, xdisp, ydisp);
+    glUniform2f(scaleUniform, xscale, yscale);
     
     // Pass texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureHandle);
+    renderState.BindTexture(0, textureHandle);
     glUniform1i(textureUniform, 0);
     checkGlError("texture");
 
-    glBindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
+    renderState.BindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
     
     // Pass vertices
-    gvPositionHandle = glGetAttribLocation(colorShader, "a_Position");
     glEnableVertexAttribArray(gvPositionHandle);
     glVertexAttribPointer(gvPositionHandle, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (const GLvoid*) 0);
     checkGlError("gvPositionHandle");
     
-    glDrawArrays(GL_TRIANGLES, 0, numVertices);
-    checkGlError("glDrawArrays");
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    DrawMesh();
+}
+
+// Queues an element in the overlay pass, which keeps submission order.
+void HUD::SubmitElement(GLuint textureHandle, float xdisp, float ydisp, float xscale, float yscale) {
+    DrawPacket & packet = renderQueue.Submit(this, RenderQueue::Key(DRAW_PASS_OVERLAY, colorShader));
+    packet.texture = textureHandle;
+    packet.parameters[0] = xdisp;
+    packet.parameters[1] = ydisp;
+    packet.parameters[2] = xscale;
+    packet.parameters[3] = yscale;
+}
+
+void HUD::Execute(const DrawPacket & packet) {
+    RenderElement(packet.texture, packet.parameters[0], packet.parameters[1], packet.parameters[2], packet.parameters[3]);
 }
 
 void HUD::Render(float health) {
-    RenderElement(healthbarBorderTex, -.15f, .9f, .8f, .06f);
-    RenderElement(healthbarTex, -.15f, .9f, .8f * health, .06f);
-    RenderElement(radarTex, -.8f, -.8f + .15f * (float) displayWidth / (float) displayHeight / 2.0f, .15f, .15f * (float) displayWidth / (float) displayHeight);
+    SubmitElement(healthbarBorderTex, -.15f, .9f, .8f, .06f);
+    SubmitElement(healthbarTex, -.15f, .9f, .8f * health, .06f);
+    SubmitElement(radarTex, -.8f, -.8f + .15f * (float) displayWidth / (float) displayHeight / 2.0f, .15f, .15f * (float) displayWidth / (float) displayHeight);
 }
 
 void HUD::ShowRadar(Eigen::Vector3f delta_pos, int color, float size) {
@@ -101,5 +110,5 @@ void HUD::ShowRadar(Eigen::Vector3f delta_pos, int color, float size) {
     GLuint renderColor = redDotTex;
     if(color == 0)
         renderColor = greenDotTex;
-    RenderElement(renderColor, -.8f + x * .15f, -.8f + .15f * (float) displayWidth / (float) displayHeight / 2.0f + y * .15f * (float) displayWidth / (float) displayHeight, size, size * (float) displayWidth / (float) displayHeight);
+    SubmitElement(renderColor, -.8f + x * .15f, -.8f + .15f * (float) displayWidth / (float) displayHeight / 2.0f + y * .15f * (float) displayWidth / (float) displayHeight, size, size * (float) displayWidth / (float) displayHeight);
 }
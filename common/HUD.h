@@ -17,9 +17,11 @@ using namespace std;
 class HUD : public RenderObject {
 public:
     HUD();
-    void Render(float health);
+    void Render(float health); // Queued, like ShowRadar, in the overlay pass
     void ShowRadar(Eigen::Vector3f delta_pos, int color, float size);
     void RenderElement(GLuint textureHandle, float xdisp, float ydisp, float xscale, float yscale);
+    void SubmitElement(GLuint textureHandle, float xdisp, float ydisp, float xscale, float yscale);
+    void Execute(const DrawPacket & packet);
     GLuint AddTexture(const char *textureFilename);
 
     GLuint healthbarTex;
@@ -27,6 +29,10 @@ public:
     GLuint radarTex;
     GLuint greenDotTex;
     GLuint redDotTex;
+
+protected:
+    GLuint displacementUniform;
+    GLuint scaleUniform;
 };
 
 
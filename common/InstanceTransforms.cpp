@@ -0,0 +1,146 @@
+// InstanceTransforms.cpp
+// nativeGraphics
+// Builds model matrices for many instances at once, straight into instance attributes
+
+#include "InstanceTransforms.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "ThreadPool.h"
+#include "Frustum.h"
+#include "transform.h"
+
+// Instances whose rotations are worked out together, before any of their
+// matrices are written
+#define INSTANCE_TRANSFORM_BLOCK 64
+
+void InstanceTransforms::Clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    yaw.clear();
+    pitch.clear();
+    scale.clear();
+    time.clear();
+}
+
+void InstanceTransforms::Add(const Vector3f & position, float yaw, float pitch, float scale, float time) {
+    x.push_back(position[0]);
+    y.push_back(position[1]);
+    z.push_back(position[2]);
+    this->yaw.push_back(yaw);
+    this->pitch.push_back(pitch);
+    this->scale.push_back(scale);
+    this->time.push_back(time);
+}
+
+void InstanceTransforms::Cull(const Matrix4f & local, const float bounds[4], std::vector<int> & indices) {
+    if(bounds[3] < 0.0f)
+        return;
+
+    // Rather than rotate each sphere's center, bound the model about the
+    // instance's origin: whichever way it faces, it stays within radius.
+    Vector3f center = (local * Eigen::Vector4f(bounds[0], bounds[1], bounds[2], 1.0f)).head<3>();
+    float localScale = local.block<3, 3>(0, 0).colwise().norm().maxCoeff();
+    float radius = center.norm() + localScale * bounds[3];
+
+    Frustum frustum;
+    frustum.Extract(transforms.mvp());
+
+    // Compacts as it goes, without branching on the result
+    int kept = 0;
+    for(int i = 0; i < Size(); i++) {
+        float r = -radius * scale[i];
+        bool inside = true;
+        for(int p = 0; p < FRUSTUM_PLANES; p++) {
+            const float * plane = frustum.planes[p];
+            inside &= plane[0] * x[i] + plane[1] * y[i] + plane[2] * z[i] + plane[3] >= r;
+        }
+        x[kept] = x[i];
+        y[kept] = y[i];
+        z[kept] = z[i];
+        yaw[kept] = yaw[i];
+        pitch[kept] = pitch[i];
+        scale[kept] = scale[i];
+        time[kept] = time[i];
+        indices[kept] = indices[i];
+        kept += inside;
+    }
+
+    x.resize(kept);
+    y.resize(kept);
+    z.resize(kept);
+    yaw.resize(kept);
+    pitch.resize(kept);
+    scale.resize(kept);
+    time.resize(kept);
+    indices.resize(kept);
+}
+
+void InstanceTransforms::Build(const Matrix4f & local, InstanceAttributes * out) const {
+    int count = Size();
+    if(count <= INSTANCE_TRANSFORM_BATCH) {
+        BuildRange(local, out, 0, count);
+        return;
+    }
+
+    int numTasks = (count + INSTANCE_TRANSFORM_BATCH - 1) / INSTANCE_TRANSFORM_BATCH;
+    std::vector<Task> tasks(numTasks);
+    std::vector<void *> taskArgs(numTasks);
+    for(int t = 0; t < numTasks; t++) {
+        tasks[t].transforms = this;
+        tasks[t].local = &local;
+        tasks[t].out = out;
+        tasks[t].begin = t * INSTANCE_TRANSFORM_BATCH;
+        tasks[t].end = std::min(count, (t + 1) * INSTANCE_TRANSFORM_BATCH);
+        taskArgs[t] = &tasks[t];
+    }
+    ThreadPool::Shared()->Run(BuildTask, &taskArgs[0], numTasks);
+}
+
+void InstanceTransforms::BuildTask(void * arg) {
+    Task * task = (Task *) arg;
+    task->transforms->BuildRange(*task->local, task->out, task->begin, task->end);
+}
+
+void InstanceTransforms::BuildRange(const Matrix4f & local, InstanceAttributes * out, int begin, int end) const {
+    const float * l = local.data(); // Column-major, l[column * 4 + row]
+
+    // Rows of rotate(0, yaw, pitch) * scalef(scale). Without an x rotation
+    // that's roty * rotz, whose middle row has no y component.
+    float r00[INSTANCE_TRANSFORM_BLOCK], r01[INSTANCE_TRANSFORM_BLOCK], r02[INSTANCE_TRANSFORM_BLOCK];
+    float r10[INSTANCE_TRANSFORM_BLOCK], r11[INSTANCE_TRANSFORM_BLOCK];
+    float r20[INSTANCE_TRANSFORM_BLOCK], r21[INSTANCE_TRANSFORM_BLOCK], r22[INSTANCE_TRANSFORM_BLOCK];
+
+    for(int block = begin; block < end; block += INSTANCE_TRANSFORM_BLOCK) {
+        int count = std::min(end - block, INSTANCE_TRANSFORM_BLOCK);
+
+        for(int i = 0; i < count; i++) {
+            float cy = cosf(yaw[block + i]), sy = sinf(yaw[block + i]);
+            float cz = cosf(pitch[block + i]), sz = sinf(pitch[block + i]);
+            float s = scale[block + i];
+            r00[i] = s * cy * cz;
+            r01[i] = -s * cy * sz;
+            r02[i] = s * sy;
+            r10[i] = s * sz;
+            r11[i] = s * cz;
+            r20[i] = -s * sy * cz;
+            r21[i] = s * sy * sz;
+            r22[i] = s * cy;
+        }
+
+        for(int i = 0; i < count; i++) {
+            float * model = out[block + i].model;
+            float px = x[block + i], py = y[block + i], pz = z[block + i];
+            for(int c = 0; c < 4; c++) {
+                const float * column = l + c * 4;
+                model[c * 4 + 0] = r00[i] * column[0] + r01[i] * column[1] + r02[i] * column[2] + px * column[3];
+                model[c * 4 + 1] = r10[i] * column[0] + r11[i] * column[1] + py * column[3];
+                model[c * 4 + 2] = r20[i] * column[0] + r21[i] * column[1] + r22[i] * column[2] + pz * column[3];
+                model[c * 4 + 3] = column[3];
+            }
+            out[block + i].time = time[block + i];
+        }
+    }
+}
@@ -0,0 +1,58 @@
+// InstanceTransforms.h
+// nativeGraphics
+// Builds model matrices for many instances at once, straight into instance attributes
+
+#ifndef __nativeGraphics__InstanceTransforms__
+#define __nativeGraphics__InstanceTransforms__
+
+#include <vector>
+
+#include "RenderObject.h"
+
+#include "Eigen/Core"
+
+using Eigen::Matrix4f;
+using Eigen::Vector3f;
+
+// Instances per task when Build splits the work across the thread pool.
+// Smaller batches are built on the calling thread.
+#define INSTANCE_TRANSFORM_BATCH 1024
+
+// Where each instance is, as a structure of arrays so Build can run plain
+// loops over contiguous floats. Each model matrix is
+//   translate(position) * rotate(0, yaw, pitch) * scalef(scale) * local
+// the same as pushing those onto the model-view stack, but without the 4x4
+// products: rotate's x angle is always 0, so the rotation has a closed form.
+class InstanceTransforms {
+public:
+    void Clear();
+    void Add(const Vector3f & position, float yaw, float pitch, float scale, float time);
+    int Size() const { return x.size(); }
+
+    // Drops the instances whose model, given its bounding sphere (center,
+    // radius) and local transform, is outside the view frustum of the
+    // current model-view. indices are kept in step.
+    void Cull(const Matrix4f & local, const float bounds[4], std::vector<int> & indices);
+
+    // Writes Size() model matrices and animation times to out. The MVP is
+    // left to the vertex shader, which has the projection and view anyway.
+    void Build(const Matrix4f & local, InstanceAttributes * out) const;
+
+private:
+    struct Task {
+        const InstanceTransforms * transforms;
+        const Matrix4f * local;
+        InstanceAttributes * out;
+        int begin, end;
+    };
+
+    static void BuildTask(void * task);
+    void BuildRange(const Matrix4f & local, InstanceAttributes * out, int begin, int end) const;
+
+    std::vector<float> x, y, z;
+    std::vector<float> yaw, pitch; // As in characterInstance::rot
+    std::vector<float> scale;
+    std::vector<float> time;
+};
+
+#endif // __nativeGraphics__InstanceTransforms__
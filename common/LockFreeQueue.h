@@ -0,0 +1,65 @@
+// LockFreeQueue.h
+// nativeGraphics
+// Unbounded multiple-producer, single-consumer queue without locks
+
+#ifndef __nativeGraphics__LockFreeQueue__
+#define __nativeGraphics__LockFreeQueue__
+
+#include <cstddef>
+
+// Any thread may Push. Only one thread at a time may Pop. Producers swap
+// themselves in at the back with an atomic exchange, and the consumer follows
+// next links from a dummy node at the front, so neither side ever waits.
+template <typename T>
+class LockFreeQueue {
+public:
+    LockFreeQueue() {
+        back = front = new Node();
+    }
+
+    ~LockFreeQueue() {
+        T value;
+        while(Pop(value))
+            ;
+        delete front;
+    }
+
+    void Push(const T & value) {
+        Node * node = new Node();
+        node->value = value;
+
+        // Make the node's contents visible before it can be reached.
+        __sync_synchronize();
+        Node * previous = __sync_lock_test_and_set(&back, node);
+        previous->next = node;
+    }
+
+    // Returns false if the queue is empty, or if the next push has not yet
+    // been linked in (it will be seen by a later Pop).
+    bool Pop(T & value) {
+        Node * next = front->next;
+        if(next == NULL)
+            return false;
+        __sync_synchronize();
+
+        value = next->value;
+        delete front;
+        front = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        Node() : next(NULL) {}
+        Node * volatile next;
+        T value;
+    };
+
+    Node * volatile back; // Written by producers
+    Node * front; // Consumer only; front->next holds the oldest value
+
+    LockFreeQueue(const LockFreeQueue &);
+    LockFreeQueue & operator=(const LockFreeQueue &);
+};
+
+#endif // __nativeGraphics__LockFreeQueue__
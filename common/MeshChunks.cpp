@@ -0,0 +1,117 @@
+// MeshChunks.cpp
+// nativeGraphics
+// Splits big meshes into spatial chunks that can be culled separately
+
+#include "MeshChunks.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+static inline unsigned int indexAt(const void * indices, int indexSize, int i) {
+    if(indexSize == sizeof(unsigned short))
+        return ((const unsigned short *) indices)[i];
+    return ((const unsigned int *) indices)[i];
+}
+
+// Bounding sphere of the vertices of a run of triangles, as boundingSphere
+static void chunkBounds(const float * vertices, int floatsPerVertex, const void * indices, int indexSize,
+                        int firstIndex, int numIndices, float sphere[4]) {
+    float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for(int i = firstIndex; i < firstIndex + numIndices; i++) {
+        const float * position = vertices + indexAt(indices, indexSize, i) * floatsPerVertex;
+        for(int j = 0; j < 3; j++) {
+            lower[j] = std::min(lower[j], position[j]);
+            upper[j] = std::max(upper[j], position[j]);
+        }
+    }
+    for(int j = 0; j < 3; j++)
+        sphere[j] = .5f * (lower[j] + upper[j]);
+
+    float radiusSquared = 0.0f;
+    for(int i = firstIndex; i < firstIndex + numIndices; i++) {
+        const float * position = vertices + indexAt(indices, indexSize, i) * floatsPerVertex;
+        float dx = position[0] - sphere[0], dy = position[1] - sphere[1], dz = position[2] - sphere[2];
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    sphere[3] = sqrtf(radiusSquared);
+}
+
+bool buildMeshChunks(const float * vertices, int floatsPerVertex, const void * indices, int indexSize, int numIndices,
+                     void * sortedIndices, std::vector<MeshChunk> & chunks) {
+    int numTriangles = numIndices / 3;
+    if(numTriangles < MESH_CHUNK_TRIANGLES * MESH_CHUNK_MIN_CHUNKS)
+        return false;
+
+    // Triangle centroids, and the box around them
+    std::vector<float> centroids(numTriangles * 3);
+    float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for(int t = 0; t < numTriangles; t++) {
+        float * centroid = &centroids[t * 3];
+        centroid[0] = centroid[1] = centroid[2] = 0.0f;
+        for(int corner = 0; corner < 3; corner++) {
+            const float * position = vertices + indexAt(indices, indexSize, t * 3 + corner) * floatsPerVertex;
+            for(int j = 0; j < 3; j++)
+                centroid[j] += position[j] / 3.0f;
+        }
+        for(int j = 0; j < 3; j++) {
+            lower[j] = std::min(lower[j], centroid[j]);
+            upper[j] = std::max(upper[j], centroid[j]);
+        }
+    }
+
+    // Roughly cubic cells, as many as there should be chunks. Flat meshes
+    // get a single layer of cells in their thin dimension.
+    float extent[3];
+    float largest = 0.0f;
+    for(int j = 0; j < 3; j++) {
+        extent[j] = upper[j] - lower[j];
+        largest = std::max(largest, extent[j]);
+    }
+    if(largest <= 0.0f)
+        return false;
+    float volume = 1.0f;
+    for(int j = 0; j < 3; j++)
+        volume *= std::max(extent[j], largest * .001f);
+    float cellSize = cbrtf(volume / (numTriangles / MESH_CHUNK_TRIANGLES));
+    int dims[3];
+    for(int j = 0; j < 3; j++)
+        dims[j] = std::max(1, (int) ceilf(extent[j] / cellSize));
+    int numCells = dims[0] * dims[1] * dims[2];
+
+    // Counting sort of the triangles by cell
+    std::vector<int> cellOf(numTriangles);
+    std::vector<int> cellStart(numCells + 1, 0);
+    for(int t = 0; t < numTriangles; t++) {
+        int cell[3];
+        for(int j = 0; j < 3; j++) {
+            float position = extent[j] > 0.0f ? (centroids[t * 3 + j] - lower[j]) / extent[j] * dims[j] : 0.0f;
+            cell[j] = std::min(dims[j] - 1, (int) position);
+        }
+        cellOf[t] = (cell[2] * dims[1] + cell[1]) * dims[0] + cell[0];
+        cellStart[cellOf[t] + 1]++;
+    }
+    for(int c = 0; c < numCells; c++)
+        cellStart[c + 1] += cellStart[c];
+
+    std::vector<int> next(cellStart.begin(), cellStart.end() - 1);
+    for(int t = 0; t < numTriangles; t++) {
+        int destination = next[cellOf[t]]++;
+        memcpy((char *) sortedIndices + destination * 3 * indexSize, (const char *) indices + t * 3 * indexSize, 3 * indexSize);
+    }
+
+    chunks.clear();
+    for(int c = 0; c < numCells; c++) {
+        if(cellStart[c] == cellStart[c + 1])
+            continue;
+        MeshChunk chunk;
+        chunk.firstIndex = cellStart[c] * 3;
+        chunk.numIndices = (cellStart[c + 1] - cellStart[c]) * 3;
+        chunkBounds(vertices, floatsPerVertex, sortedIndices, indexSize, chunk.firstIndex, chunk.numIndices, chunk.bounds);
+        chunks.push_back(chunk);
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+// MeshChunks.h
+// nativeGraphics
+// Splits big meshes into spatial chunks that can be culled separately
+
+#ifndef __nativeGraphics__MeshChunks__
+#define __nativeGraphics__MeshChunks__
+
+#include <vector>
+
+// Triangles per chunk to aim for. Meshes with fewer than
+// MESH_CHUNK_MIN_CHUNKS times this many are left whole.
+#define MESH_CHUNK_TRIANGLES 1024
+#define MESH_CHUNK_MIN_CHUNKS 16
+
+// A run of triangles in the index buffer, all in one cell of the grid
+struct MeshChunk {
+    int firstIndex;
+    int numIndices;
+    float bounds[4]; // Bounding sphere of its vertices: center, then radius
+};
+
+// Sorts a mesh's triangles into a uniform grid by their centroids, sized
+// for about MESH_CHUNK_TRIANGLES triangles per cell. Writes the indices
+// (indexSize bytes each) reordered so each chunk's triangles are
+// contiguous to sortedIndices, and one chunk per non-empty cell to chunks.
+// Returns false, writing nothing, if the mesh is too small to bother.
+bool buildMeshChunks(const float * vertices, int floatsPerVertex, const void * indices, int indexSize, int numIndices,
+                     void * sortedIndices, std::vector<MeshChunk> & chunks);
+
+#endif // __nativeGraphics__MeshChunks__
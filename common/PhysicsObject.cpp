@@ -19,18 +19,38 @@ using Eigen::Vector4f;
 PhysicsObject::PhysicsObject(const char *objFilename, const char *vertexShaderFilename, const char *fragmentShaderFilename, bool collide)
                                                   : RenderObject(objFilename, vertexShaderFilename, fragmentShaderFilename)  {
     ScreenSpaceCollisions = collide;
+    if(!vertexShaderFilename)
+        EnableInstancing(fragmentShaderFilename);
 }
 
 inline float clamp(float x, float a, float b) {
     return x < a ? a : (x > b ? b : x);
 }
 
-void PhysicsObject::Update() {
+void PhysicsObject::Collide() {
+    if(!ScreenSpaceCollisions)
+        return;
+    for(int i = 0; i < instances.size(); i++) {
+        struct physicsInstance * instance = &instances[i];
+        instance->contactNormal = Vector3f(0, 0, 0);
+
+        // Get the position in screen space
+        Vector4f MVP_POS = transforms.mvp()*Vector4f(instance->position[0], instance->position[1], instance->position[2], 1.0);
+        float x = ((1.0f + MVP_POS(0) / MVP_POS(3)) / 2.0f);
+        float y = ((1.0f + MVP_POS(1) / MVP_POS(3)) / 2.0f);
+        
+        float depth = pipeline->getDepth(x, y);
+        if(depth < .5f * (1.0f + MVP_POS(2) / MVP_POS(3)))
+            instance->contactNormal = pipeline->getNormal(x, y, transforms.mvpInverse());
+    }
+}
+
+void PhysicsObject::Update(float dt) {
     for(int i = 0; i < instances.size(); i++)
-        Update(i);
+        Update(i, dt);
 }
 
-void PhysicsObject::Update(int instanceNum) {
+void PhysicsObject::Update(int instanceNum, float timeElapsed) {
     if(instanceNum >= instances.size()) {
         LOGE("PhysicsObject::Update: Out of bounds exception.");
         return;
@@ -38,24 +58,15 @@ void PhysicsObject::Update(int instanceNum) {
 
     struct physicsInstance * instance = &instances[instanceNum];
 
-    float timeElapsed = instance->lastUpdate.getSeconds();
-    instance->lastUpdate.reset();
+    instance->previousPosition = instance->position;
+    instance->age += timeElapsed;
 
     instance->velocity += instance->acceleration * timeElapsed;
     
-    if(ScreenSpaceCollisions) {
-        // Get the position in screen space
-        Vector4f MVP_POS = projection.top()*model_view.top()*Vector4f(instance->position[0], instance->position[1], instance->position[2], 1.0);
-        float x = ((1.0f + MVP_POS(0) / MVP_POS(3)) / 2.0f);
-        float y = ((1.0f + MVP_POS(1) / MVP_POS(3)) / 2.0f);
-        
-        uint8_t depth = pipeline->getDepth(x, y);
-        if(depth < 256 * MVP_POS(2) / MVP_POS(3)) {
-            Vector3f normal = pipeline->getNormal(x, y, projection.top()*model_view.top());
-            if(instance->velocity.dot(normal) < 0)
-                instance->velocity = COEFF_RESTITUTION * (-2 * instance->velocity.dot(normal) * normal + instance->velocity);
-        }
-    }
+    // Bounces once, since the velocity then points away from the surface
+    Vector3f normal = instance->contactNormal;
+    if(instance->velocity.dot(normal) < 0)
+        instance->velocity = COEFF_RESTITUTION * (-2 * instance->velocity.dot(normal) * normal + instance->velocity);
     
     for(int i = 0; i < 3; i++)
         instance->velocity(i) = clamp(instance->velocity(i), -MAX_VELOCITY, MAX_VELOCITY);
@@ -64,3 +75,20 @@ void PhysicsObject::Update(int instanceNum) {
     
 }
 
+void PhysicsObject::SubmitAll(float alpha, const Matrix4f & local, float maxAge) {
+    placements.Clear();
+    drawnInstances.clear();
+    for(int i = 0; i < instances.size(); i++) {
+        if(instances[i].age > maxAge)
+            continue;
+        placements.Add(instances[i].RenderPosition(alpha), 0.0f, 0.0f, 1.0f, instances[i].age);
+        drawnInstances.push_back(i);
+    }
+    if(cull)
+        placements.Cull(local, bounds, drawnInstances);
+    if(drawnInstances.empty())
+        return;
+
+    placements.Build(local, AddInstances(&drawnInstances[0], drawnInstances.size()));
+    SubmitInstances();
+}
@@ -7,42 +7,67 @@
 #include "graphics_header.h"
 
 #include "RenderObject.h"
-#include "Timer.h"
+#include "InstanceTransforms.h"
 
 #include <vector>
 
 #include "Eigen/Core"
 
 using Eigen::Vector3f;
+using Eigen::Matrix4f;
 
 using namespace std;
 
 struct physicsInstance {
     physicsInstance() {
         position = Vector3f(0, 0, 0);
+        previousPosition = Vector3f(0, 0, 0);
         velocity = Vector3f(0, 0, 0);
         acceleration = Vector3f(0, -500.0, 0);
-        timer.reset();
-        lastUpdate.reset();
+        contactNormal = Vector3f(0, 0, 0);
+        age = 0.0f;
+    }
+
+    // Moves without interpolating from the old position.
+    void Teleport(const Vector3f & p) {
+        position = previousPosition = p;
+    }
+
+    // Position between the last two simulation steps.
+    Vector3f RenderPosition(float alpha) const {
+        return previousPosition + alpha * (position - previousPosition);
     }
 
     Vector3f position;
+    Vector3f previousPosition;
     Vector3f velocity;
     Vector3f acceleration;
-    Timer timer;
-    Timer lastUpdate;
+    Vector3f contactNormal; // Of the surface Collide last found it in, or zero
+    float age; // Simulated seconds since creation
 };
 
 class PhysicsObject : public RenderObject {
 public:
     PhysicsObject(const char *objFile, const char *vertexShaderFile, const char *fragmentShaderFile, bool collide = true);
-    void Update(); // Update all instances
-    void Update(int instance); // Update a specific instance
+    // Tests every instance against the depth in the g buffer, for the steps
+    // that follow to bounce off. Reads back from the GPU, so call it once a
+    // frame, after the geometry pass, rather than every step.
+    void Collide();
+    void Update(float dt); // Update all instances
+    void Update(int instance, float dt); // Update a specific instance
+
+    // Queues every instance no older than maxAge for one instanced draw, at
+    // its position between the last two steps. local is applied first.
+    void SubmitAll(float alpha, const Matrix4f & local, float maxAge);
 
     vector<struct physicsInstance> instances;
 
 private:
     bool ScreenSpaceCollisions;
+
+    // Scratch space for SubmitAll, kept to reuse its storage
+    InstanceTransforms placements;
+    vector<int> drawnInstances;
 };
 
 
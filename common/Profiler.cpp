@@ -0,0 +1,222 @@
+// Profiler.cpp
+// nativeGraphics
+// Hierarchical per-frame CPU/GPU zone timings, exportable as a Chrome trace
+
+#include "Profiler.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "Timer.h"
+#include "log.h"
+
+// GPU results are read back this many frames later, so the GPU has time to
+// catch up without stalling the CPU.
+#define PROFILER_QUERY_LATENCY 3
+
+static bool TimerQueriesSupported() {
+#if defined(PROFILER_GPU_QUERIES) && defined(GLEW_ARB_timer_query)
+    // glewInit can fail without a window system (see headless.cpp), leaving
+    // the extension flags unset even though the entry points loaded.
+    if(!glQueryCounter || !glGetQueryObjectui64v || !glGetInteger64v)
+        return false;
+    const char * extensions = (const char *) glGetString(GL_EXTENSIONS);
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query || (extensions && strstr(extensions, "GL_ARB_timer_query"));
+#else
+    return false;
+#endif
+}
+
+Profiler::Profiler() : enabled(false), gpuQueries(false), inFrame(false), frameNumber(0), gpuOffset(0.0) {
+    epoch = monotonicSeconds();
+    frames.resize(PROFILER_FRAMES);
+    for(int i = 0; i < frames.size(); i++)
+        frames[i].number = -1;
+}
+
+void Profiler::Enable(bool gpu) {
+    enabled = true;
+    gpuQueries = gpu && TimerQueriesSupported();
+    if(gpu && !gpuQueries) {
+        LOGI("Profiler: GL timer queries unsupported, recording CPU times only");
+    }
+#ifdef PROFILER_GPU_QUERIES
+    if(gpuQueries) {
+        // Lines the GL clock up with ours, so both fit on one timeline.
+        GLint64 now;
+        glGetInteger64v(GL_TIMESTAMP, &now);
+        gpuOffset = now / 1000000000.0 - (monotonicSeconds() - epoch);
+    }
+#endif // PROFILER_GPU_QUERIES
+}
+
+void Profiler::Disable() {
+    enabled = false;
+}
+
+void Profiler::BeginFrame() {
+    inFrame = enabled;
+    if(!inFrame)
+        return;
+
+    ProfileFrame & frame = frames[frameNumber % frames.size()];
+    if(frame.number >= 0)
+        CollectQueries(frame, true); // Long finished, so this won't stall
+    frame.number = frameNumber;
+    frame.zones.clear();
+    BeginZone("Frame");
+}
+
+void Profiler::EndFrame() {
+    if(!inFrame)
+        return;
+
+    // Anything still open ends with the frame.
+    while(!openZones.empty())
+        EndZone();
+    inFrame = false;
+
+    int previous = frameNumber - PROFILER_QUERY_LATENCY;
+    if(previous >= 0)
+        CollectQueries(frames[previous % frames.size()], false);
+    frameNumber++;
+}
+
+void Profiler::BeginZone(const char * name) {
+    if(!inFrame) {
+        openZones.push_back(-1);
+        return;
+    }
+
+    ProfileFrame & frame = frames[frameNumber % frames.size()];
+    ProfileZone zone;
+    zone.name = name;
+    zone.depth = openZones.size();
+    zone.cpuStart = monotonicSeconds() - epoch;
+    zone.cpuEnd = zone.cpuStart;
+    zone.gpuStart = zone.gpuEnd = -1.0;
+    zone.queries[0] = zone.queries[1] = 0;
+#ifdef PROFILER_GPU_QUERIES
+    if(gpuQueries) {
+        zone.queries[0] = NewQuery();
+        glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+    }
+#endif // PROFILER_GPU_QUERIES
+
+    openZones.push_back(frame.zones.size());
+    frame.zones.push_back(zone);
+}
+
+void Profiler::EndZone() {
+    if(openZones.empty()) {
+        LOGE("Profiler::EndZone: No open zone.");
+        return;
+    }
+    int index = openZones.back();
+    openZones.pop_back();
+    if(index < 0 || !inFrame)
+        return;
+
+    ProfileZone & zone = frames[frameNumber % frames.size()].zones[index];
+    zone.cpuEnd = monotonicSeconds() - epoch;
+#ifdef PROFILER_GPU_QUERIES
+    if(zone.queries[0]) {
+        zone.queries[1] = NewQuery();
+        glQueryCounter(zone.queries[1], GL_TIMESTAMP);
+    }
+#endif // PROFILER_GPU_QUERIES
+}
+
+// Reads back finished queries and returns them to the free list. With wait,
+// blocks until every query in the frame has a result.
+void Profiler::CollectQueries(ProfileFrame & frame, bool wait) {
+#ifdef PROFILER_GPU_QUERIES
+    for(int i = 0; i < frame.zones.size(); i++) {
+        ProfileZone & zone = frame.zones[i];
+        if(!zone.queries[0])
+            continue;
+        if(!zone.queries[1]) { // Never closed
+            freeQueries.push_back(zone.queries[0]);
+            zone.queries[0] = 0;
+            continue;
+        }
+
+        if(!wait) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available)
+                return; // Later queries won't be ready either
+        }
+
+        GLuint64 start, end;
+        glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+        zone.gpuStart = start / 1000000000.0 - gpuOffset;
+        zone.gpuEnd = end / 1000000000.0 - gpuOffset;
+        freeQueries.push_back(zone.queries[0]);
+        freeQueries.push_back(zone.queries[1]);
+        zone.queries[0] = zone.queries[1] = 0;
+    }
+#endif // PROFILER_GPU_QUERIES
+}
+
+GLuint Profiler::NewQuery() {
+    GLuint query = 0;
+#ifdef PROFILER_GPU_QUERIES
+    if(!freeQueries.empty()) {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    } else
+        glGenQueries(1, &query);
+#endif // PROFILER_GPU_QUERIES
+    return query;
+}
+
+std::vector<const ProfileFrame *> Profiler::RecentFrames(int n) const {
+    std::vector<const ProfileFrame *> recent;
+    int first = frameNumber - n;
+    if(first < frameNumber - (int) frames.size())
+        first = frameNumber - frames.size();
+    if(first < 0)
+        first = 0;
+    for(int i = first; i < frameNumber; i++)
+        recent.push_back(&frames[i % frames.size()]);
+    return recent;
+}
+
+// Zone names are string literals, so need no escaping.
+static void WriteEvent(FILE * file, const char * name, int thread, double start, double end, int frameNumber) {
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%d}}",
+            name, thread, start * 1000000.0, (end - start) * 1000000.0, frameNumber);
+}
+
+bool Profiler::WriteChromeTrace(const char * fileName) {
+    FILE * file = fopen(fileName, "w");
+    if(!file) {
+        LOGE("Unable to write trace %s", fileName);
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n"
+                  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+                  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    std::vector<const ProfileFrame *> recent = RecentFrames(frames.size());
+    for(int i = 0; i < recent.size(); i++) {
+        ProfileFrame & frame = frames[recent[i]->number % frames.size()];
+        CollectQueries(frame, true);
+        for(int j = 0; j < frame.zones.size(); j++) {
+            const ProfileZone & zone = frame.zones[j];
+            WriteEvent(file, zone.name, 1, zone.cpuStart, zone.cpuEnd, frame.number);
+            if(zone.gpuStart >= 0.0)
+                WriteEvent(file, zone.name, 2, zone.gpuStart, zone.gpuEnd, frame.number);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = !ferror(file);
+    fclose(file);
+    if(!ok) {
+        LOGE("Unable to write trace %s", fileName);
+    }
+    return ok;
+}
@@ -0,0 +1,96 @@
+// Profiler.h
+// nativeGraphics
+// Hierarchical per-frame CPU/GPU zone timings, exportable as a Chrome trace
+
+#ifndef __nativeGraphics__Profiler__
+#define __nativeGraphics__Profiler__
+
+#include <vector>
+
+#include "graphics_header.h"
+
+#define PROFILER_FRAMES 240 // Frames kept in the ring buffer
+
+// Desktop GL has timestamp queries through ARB_timer_query. GLES2 has no
+// core equivalent, so there only CPU times are recorded.
+#if defined(GL_TIMESTAMP) && !defined(ANDROID_NDK)
+#define PROFILER_GPU_QUERIES
+#endif
+
+struct ProfileZone {
+    const char * name; // Must outlive the profiler, e.g. a string literal
+    int depth; // 0 for zones opened outside any other zone
+    double cpuStart; // Seconds since the profiler was created
+    double cpuEnd;
+    double gpuStart; // Seconds on the GL clock, or -1 if unavailable
+    double gpuEnd;
+    GLuint queries[2];
+};
+
+struct ProfileFrame {
+    int number; // -1 if this slot has never been filled
+    std::vector<ProfileZone> zones; // In the order they were opened
+};
+
+// Zones are only recorded between BeginFrame and EndFrame, and while the
+// profiler is enabled. Use PROFILE_ZONE rather than calling BeginZone and
+// EndZone directly.
+class Profiler {
+public:
+    Profiler();
+
+    // gpu also times zones with GL timer queries, where supported. Must be
+    // called on the GL thread.
+    void Enable(bool gpu);
+    void Disable();
+    bool IsEnabled() const { return enabled; }
+
+    void BeginFrame();
+    void EndFrame();
+
+    void BeginZone(const char * name);
+    void EndZone();
+
+    // The last n complete frames, oldest first. GPU times lag a few frames
+    // behind, until their queries are available.
+    std::vector<const ProfileFrame *> RecentFrames(int n) const;
+
+    // Writes the recorded frames in Chrome's trace event format, viewable in
+    // chrome://tracing or Perfetto. CPU zones go on one track and GPU zones on
+    // another. Returns false if the file couldn't be written.
+    bool WriteChromeTrace(const char * fileName);
+
+private:
+    void CollectQueries(ProfileFrame & frame, bool wait);
+    GLuint NewQuery();
+
+    bool enabled;
+    bool gpuQueries;
+    bool inFrame;
+    int frameNumber;
+    double epoch; // monotonicSeconds() at construction
+    double gpuOffset; // GL clock minus ours, in seconds
+    std::vector<ProfileFrame> frames; // Ring buffer, indexed by frame number
+    std::vector<int> openZones; // Indices into the current frame's zones
+    std::vector<GLuint> freeQueries;
+};
+
+// Times its enclosing scope.
+class ProfileScope {
+public:
+    ProfileScope(Profiler & profiler, const char * name) : profiler(profiler) {
+        profiler.BeginZone(name);
+    }
+    ~ProfileScope() {
+        profiler.EndZone();
+    }
+
+private:
+    Profiler & profiler;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profileZone, __LINE__)(profiler, name)
+
+#endif // __nativeGraphics__Profiler__
@@ -7,14 +7,14 @@
 //
 
 #include "RenderDestructible.h"
-#include "glsl_helper.h"
-#include "transform.h"
 #include "common.h"
 #include "log.h"
 
 #include "Vector3.h"
 #include "Point3.h"
 #include "obj_parser.h"
+#include "obj_scanner.h"
+#include "ThreadPool.h"
 
 #define voxelSize 20.0
 
@@ -102,210 +102,156 @@ int node_counter = 0;
 int cell_counter = 0;
 static void parseObjString(char * line);
 
-RenderDestructible::RenderDestructible(const char *objFilename, const char *vertexShaderFilename, const char *fragmentShaderFilename) : RenderObject(objFilename, vertexShaderFilename, fragmentShaderFilename) {
-    
+RenderDestructible::RenderDestructible() {
+    Init();
+}
+
+void RenderDestructible::Init() {
     nodes.erase(nodes.begin(), nodes.end());
     bonds.erase(bonds.begin(), bonds.end());
     surfaces.erase(surfaces.begin(), surfaces.end());
     fragments.erase(fragments.begin(), fragments.end());
     cells.erase(cells.begin(), cells.end());
     explode = false;
+    cull = false; // Pieces fly well beyond the mesh's bounds
     
     parseObjString((char *)loadResource("subvox.obj"));
 }
 
-static void parseObjLine(char * line) {
-	char * saveptr;
-	char * tok = strtok_r(line, " ", &saveptr);
-	if(tok == NULL || tok[0] == '#')
-		return;
-    
-	// Parse a vertex
-	if(strcmp(tok, "v") == 0) {
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		float x = atof(tok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		float y = atof(tok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		float z = atof(tok);
-        
-		nodes.push_back(new DestructibleNode(x, y, z));
-	}
-    
-	// Parse a face
-	if(strcmp(tok, "f") == 0) {
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		int v1 = atoi(tok); // Zero index
-        
-		char*texsaveptr;
-		int texIndex[3] = {-1,-1,-1};
-		strtok_r(tok, "/", &texsaveptr);
-		char * textok = strtok_r(NULL, "/", &texsaveptr);
-		if(textok != NULL)
-			texIndex[0] = atoi(textok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		int v2 = atoi(tok);
-        
-		strtok_r(tok, "/", &texsaveptr);
-		textok = strtok_r(NULL, "/", &texsaveptr);
-		if(textok != NULL)
-			texIndex[1] = atoi(textok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		int v3 = atoi(tok);
-        
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
+// One "v", "f", "b" or "cn" line of the destructible obj format. Lines are
+// tokenized in parallel, but applied in file order since faces and cells
+// refer back to the nodes, bonds and cells created before them.
+struct DestructibleRecord
+{
+    char type;
+    float position[3];
+    int index[8];
+};
+
+struct DestructibleChunk
+{
+    const char *begin;
+    const char *end;
+    vector<DestructibleRecord> records;
+};
+
+static bool scanIndices(const char *&p, const char *end, int *index, int count) {
+    for (int i = 0; i < count; i++) {
+        p = skipBlanks(p, end);
+        if (!scanInt(p, end, index[i]))
+            return false;
+        p = skipToken(p, end); // Ignore texture indices
+    }
+    return true;
+}
+
+static void parseObjLine(const char *line, const char *end, DestructibleChunk *chunk) {
+    const char *p = skipBlanks(line, end);
+    if (p == end || *p == '#' || *p == '\n')
+        return;
+    
+    DestructibleRecord record;
+    bool valid = true;
+    
+    // Parse a vertex
+    if (scanKeyword(p, end, "v")) {
+        record.type = 'v';
+        for (int i = 0; valid && i < 3; i++) {
+            p = skipBlanks(p, end);
+            valid = scanFloat(p, end, record.position[i]);
         }
-        int c = atoi(tok);
-        
-		strtok_r(tok, "/", &texsaveptr);
-		textok = strtok_r(NULL, "/", &texsaveptr);
-		if(textok != NULL)
-			texIndex[2] = atoi(textok);
-        
-		/*struct face thisFace = face(v1, v2, v3);
-         thisFace.texture[0] = texIndex[0];
-         thisFace.texture[1] = texIndex[1];
-         thisFace.texture[2] = texIndex[2];*/
-		surfaces.push_back(new DestructibleFace(nodes[v1], nodes[v2], nodes[v3], cells[c]));
     }
+    // Parse a face: three nodes and the cell it belongs to (zero indexed)
+    else if (scanKeyword(p, end, "f")) {
+        record.type = 'f';
+        valid = scanIndices(p, end, record.index, 4);
+    }
+    // Parse a bond
+    else if (scanKeyword(p, end, "b")) {
+        record.type = 'b';
+        valid = scanIndices(p, end, record.index, 2);
+    }
+    // Parse a cell
+    else if (scanKeyword(p, end, "cn")) {
+        record.type = 'c';
+        valid = scanIndices(p, end, record.index, 8);
+    }
+    else
+        return;
     
-    //Parse a bond
-    if(strcmp(tok, "b") == 0) {
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        float n1 = atof(tok);
-        
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        float n2 = atof(tok);
-        DestructibleNode *node1 = nodes[n1];
-        DestructibleNode *node2 = nodes[n2];
-        DestructibleBond *bond = createBond(node1, node2);
-        bonds.push_back(bond);
+    if (!valid) {
+        LOGE("Error in ParseObjLine");
+        return;
     }
+    chunk->records.push_back(record);
+}
+
+static void parseObjChunk(void *arg) {
+    DestructibleChunk *chunk = (DestructibleChunk *)arg;
+    for (const char *line = chunk->begin; line < chunk->end; line = nextLine(line, chunk->end))
+        parseObjLine(line, chunk->end, chunk);
+}
+
+static void buildCell(const int *node_idxs, int numNodes) {
+    DestructibleCell *cell = new DestructibleCell;
     
-    // Parse a cell
-    if(strcmp(tok, "cn") == 0) {
-        vector<int> node_idxs;
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
-        tok = strtok_r(NULL, " ", &saveptr);
-        if(tok == NULL || tok[0] == '#') {
-            LOGE("Error in ParseObjLine");
-            return;
-        }
-        node_idxs.push_back(atoi(tok));
+    for (int i = 0; i < numNodes; i++) {
+        DestructibleNode *node = nodes[node_idxs[i]];
+        cell->nodes.push_back(node);
         
-        DestructibleCell *cell = new DestructibleCell;
-        
-        for (int i = 0; i < node_idxs.size(); i++) {
-            DestructibleNode *node = nodes[node_idxs[i]];
-            cell->nodes.push_back(node);
+        for (int j = 0; j < node->bonds.size(); j++) {
+            DestructibleBond *bond = node->bonds[j];
+            DestructibleNode *node2 = bond->nodes[0];
+            if (node == node2)
+                node2 = bond->nodes[1];
             
-            for (int j = 0; j < node->bonds.size(); j++) {
-                DestructibleBond *bond = node->bonds[j];
-                DestructibleNode *node2 = bond->nodes[0];
-                if (node == node2)
-                    node2 = bond->nodes[1];
-                
-                for (int k = i; k < node_idxs.size(); k++) {
-                    if (node2 == nodes[node_idxs[k]]) {
-                        cell->bonds.push_back(bond);
-                        bond->cells.push_back(cell);
-                    }
+            for (int k = i; k < numNodes; k++) {
+                if (node2 == nodes[node_idxs[k]]) {
+                    cell->bonds.push_back(bond);
+                    bond->cells.push_back(cell);
                 }
             }
         }
-        cells.push_back(cell);
     }
-    
+    cells.push_back(cell);
 }
+
 static void parseObjString(char * objString) {
     
-	char * saveptr;
-	char * line = strtok_r(objString, "\n", &saveptr);
-	while(line != NULL) {
-		parseObjLine(line);
-		line = strtok_r(NULL, "\n", &saveptr);
-	}
+    // Tokenize newline-aligned chunks of the file in parallel
+    ThreadPool *pool = ThreadPool::Shared();
+    vector<const char *> boundaries = splitLines(objString, objString + strlen(objString), 4 * (pool->NumThreads() + 1), 65536);
+    int numChunks = boundaries.size() - 1;
+    vector<DestructibleChunk> chunks(numChunks);
+    vector<void *> chunkArgs(numChunks);
+    for (int c = 0; c < numChunks; c++) {
+        chunks[c].begin = boundaries[c];
+        chunks[c].end = boundaries[c + 1];
+        chunkArgs[c] = &chunks[c];
+    }
+    pool->Run(parseObjChunk, numChunks ? &chunkArgs[0] : NULL, numChunks);
+    
+    // Build the node / bond / cell graph in file order
+    for (int c = 0; c < numChunks; c++) {
+        for (int r = 0; r < chunks[c].records.size(); r++) {
+            const DestructibleRecord &record = chunks[c].records[r];
+            const int *index = record.index;
+            switch (record.type) {
+                case 'v':
+                    nodes.push_back(new DestructibleNode(record.position[0], record.position[1], record.position[2]));
+                    break;
+                case 'f':
+                    surfaces.push_back(new DestructibleFace(nodes[index[0]], nodes[index[1]], nodes[index[2]], cells[index[3]]));
+                    break;
+                case 'b':
+                    bonds.push_back(createBond(nodes[index[0]], nodes[index[1]]));
+                    break;
+                case 'c':
+                    buildCell(index, 8);
+                    break;
+            }
+        }
+    }
 }
 
 static struct DestructibleBond *createBond(DestructibleNode *node1, DestructibleNode *node2) {
@@ -494,67 +440,3 @@ GLfloat * RenderDestructible::getGeometry(int & num_vertices) {
     num_vertices = numSurfaceVertices + fragments.size()*3;
     return vertexBuffer;
 }
-
-void RenderDestructible::RenderPass(int instance, GLfloat *buffer, int num) {
-    
-    // Pass matrices
-    GLfloat* mv_Matrix = (GLfloat*)mvMatrix();
-    GLfloat* mvp_Matrix = (GLfloat*)mvpMatrix();
-    glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mv_Matrix);
-    glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvp_Matrix);
-    checkGlError("glUniformMatrix4fv");
-    delete[] mv_Matrix;
-    delete[] mvp_Matrix;
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
-    // Pass vertices
-    glEnableVertexAttribArray(gvPositionHandle);
-    glVertexAttribPointer(gvPositionHandle, 3, GL_FLOAT, GL_FALSE, 0, (const GLvoid*) buffer);
-    checkGlError("gvPositionHandle");
-
-    // Pass texture
-    if(textureUniform != -1 && texture != -1) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glUniform1i(textureUniform, 0);
-        checkGlError("texture");
-    }
-    
-    glDrawArrays(GL_TRIANGLES, 0, num);
-    checkGlError("glDrawArrays");
-    
-}
-
-void RenderDestructible::Render() {
-    
-    if(!pipeline) {
-        LOGE("RenderPipeline inaccessible.");
-        exit(0);
-    }
-    
-    int num_vertices;
-    GLfloat * geometry = getGeometry(num_vertices);
-    
-    //////////////////////////////////
-    // Render to frame buffer
-    
-    // Render colors (R, G, B, Depth_MVP)
-    SetShader(colorShader);
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, pipeline->frameBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pipeline->gBuffer, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pipeline->depthBuffer);
-    
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glDepthFunc(GL_LESS);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glDisable(GL_DITHER);
-    checkGlError("glClear");
-    
-    RenderPass(0, geometry, num_vertices);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0); // TODO: unbind other resources
-}
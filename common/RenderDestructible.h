@@ -27,12 +27,17 @@ struct DestructibleFace;
 class RenderDestructible : public RenderObject {
 public:
     RenderDestructible(const char *objFile, const char *vertexShaderFile, const char *fragmentShaderFile);
+    RenderDestructible(); // Simulation only, without GL (e.g. for benchmarks). Can't be rendered.
     void Render();
+    void Execute(const DrawPacket & packet);
     void RenderPass(int instance, GLfloat *buffer, int num);
     GLfloat * getGeometry(int & num_vertices);
 
     bool explode;
     int ***voxelGrid3D;
+
+private:
+    void Init();
 };
 
 
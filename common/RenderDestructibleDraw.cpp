@@ -0,0 +1,81 @@
+//  RenderDestructibleDraw.cpp
+//  nativeGraphics
+//  The GL side of RenderDestructible, kept apart from the simulation in
+//  RenderDestructible.cpp so the benchmark can link that without GL.
+
+#include "RenderDestructible.h"
+#include "transform.h"
+#include "UniformBuffers.h"
+#include "RenderState.h"
+#include "common.h"
+#include "log.h"
+
+RenderDestructible::RenderDestructible(const char *objFilename, const char *vertexShaderFilename, const char *fragmentShaderFilename) : RenderObject(objFilename, vertexShaderFilename, fragmentShaderFilename) {
+    Init();
+}
+
+void RenderDestructible::RenderPass(int instance, GLfloat *buffer, int num) {
+    
+    // Pass matrices
+    if(uniformBuffers.IsEnabled())
+        uniformBuffers.SetObject();
+    else {
+        glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mvMatrix());
+        glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvpMatrix());
+        checkGlError("glUniformMatrix4fv");
+    }
+    
+    renderState.BindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Pass vertices
+    glEnableVertexAttribArray(gvPositionHandle);
+    glVertexAttribPointer(gvPositionHandle, 3, GL_FLOAT, GL_FALSE, 0, (const GLvoid*) buffer);
+    checkGlError("gvPositionHandle");
+
+    // Pass texture
+    if(textureUniform != -1 && texture != -1) {
+        renderState.BindTexture(0, texture);
+        glUniform1i(textureUniform, 0);
+        checkGlError("texture");
+    }
+    
+    glDrawArrays(GL_TRIANGLES, 0, num);
+    checkGlError("glDrawArrays");
+    
+}
+
+void RenderDestructible::Execute(const DrawPacket & packet) {
+    Render();
+}
+
+void RenderDestructible::Render() {
+    
+    if(!pipeline) {
+        LOGE("RenderPipeline inaccessible.");
+        exit(0);
+    }
+    
+    if(!IsLoaded())
+        return;
+    
+    int num_vertices;
+    GLfloat * geometry = getGeometry(num_vertices);
+    
+    //////////////////////////////////
+    // Render to frame buffer
+    
+    // Render colors (R, G, B, Depth_MVP)
+    renderState.UseProgram(colorShader);
+    
+    pipeline->BindGBuffer();
+    
+    renderState.Enable(GL_DEPTH_TEST, true);
+    renderState.DepthMask(GL_TRUE);
+    renderState.DepthFunc(GL_LESS);
+    renderState.Enable(GL_CULL_FACE, false);
+    renderState.Enable(GL_BLEND, false);
+    renderState.Enable(GL_DITHER, false);
+    checkGlError("glClear");
+    
+    RenderPass(0, geometry, num_vertices);
+}
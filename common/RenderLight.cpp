@@ -2,65 +2,188 @@
 //  nativeGraphics
 
 #include "RenderLight.h"
+#include "Frustum.h"
+#include "TiledLighting.h"
 #include "glsl_helper.h"
 #include "transform.h"
+#include "UniformBuffers.h"
+#include "RenderState.h"
 #include "common.h"
 #include "log.h"
 
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// The light volume shaders whose falloff tiled_lights_f.glsl can reproduce
+static const struct {
+    const char * shader;
+    TiledLightFalloff falloff;
+} tiledFalloffs[] = {
+    { "dr_pointlight_f.glsl", TILED_LIGHT_POINT },
+    { "dr_pointlight_sat_f.glsl", TILED_LIGHT_SATURATING },
+    { "dr_explosive_pointlight_f.glsl", TILED_LIGHT_EXPLOSIVE },
+    { "dr_spotlight_f.glsl", TILED_LIGHT_SPOT }
+};
+
 RenderLight::RenderLight(const char *objFilename, const char *vertexShaderFilename, const char *fragmentShaderFilename) : RenderObject(objFilename, vertexShaderFilename, fragmentShaderFilename, false) {
    color[0] = 1.0f;
    color[1] = 1.0f;
    color[2] = 1.0f;
    brightness = 1000.0f;
+
+   const ShaderLocations & locations = shaderLocations(colorShader);
+   fragWidthUniform = locations.Uniform("u_FragWidth");
+   fragHeightUniform = locations.Uniform("u_FragHeight");
+   colorUniform = locations.Uniform("u_Color");
+   brightnessUniform = locations.Uniform("u_Brightness");
+   pInverseUniform = locations.Uniform("u_pT_Matrix");
+   gBufferUniform = locations.Uniform("u_gBuffer");
+   gDepthUniform = locations.Uniform("u_gDepth");
+
+   tiledFalloff = -1;
+   for(int i = 0; i < sizeof(tiledFalloffs) / sizeof(tiledFalloffs[0]); i++) {
+       if(strcmp(fragmentShaderFilename, tiledFalloffs[i].shader) == 0)
+           tiledFalloff = tiledFalloffs[i].falloff;
+   }
+}
+
+void RenderLight::Submit(int instance) {
+    // Volumes are flattened to z = 0 (see dr_standard_v.glsl), so the near
+    // and far planes don't clip them.
+    if(!InView(FRUSTUM_SIDE_PLANES))
+        return;
+
+    // The falloff can't light anything past its reach, which unlike the
+    // volume is tested against the depth range too
+    float reach = Reach();
+    if(reach == 0.0f)
+        return;
+    if(reach > 0.0f) {
+        Frustum frustum;
+        frustum.Extract(transforms.p());
+        if(!frustum.Intersects(transforms.mv().col(3).head<3>(), reach))
+            return;
+    }
+
+    pipeline->SubmitComposite();
+    if(SubmitTiled(reach))
+        return;
+
+    DrawPacket & packet = renderQueue.Submit(this, RenderQueue::Key(DRAW_PASS_LIGHTS, colorShader), instance);
+    for(int i = 0; i < 3; i++)
+        packet.parameters[i] = color[i];
+    packet.parameters[3] = brightness;
+}
+
+bool RenderLight::SubmitTiled(float reach) {
+    if(tiledFalloff < 0 || !tiledLighting.IsEnabled() || !IsLoaded())
+        return false;
+
+    // The volume is the mesh this would otherwise be drawn with, going by
+    // its bounding sphere
+    TiledLightVolume volume = TILED_VOLUME_SPHERE;
+    float size[2] = { sqrtf(bounds[0] * bounds[0] + bounds[1] * bounds[1] + bounds[2] * bounds[2]) + bounds[3], 0.0f };
+    if(!cull) {
+        volume = TILED_VOLUME_NONE; // Drawn over the whole screen
+    } else if(tiledFalloff == TILED_LIGHT_SPOT) {
+        // A cone from the origin down -y (see cone.obj), whose bounding
+        // sphere is centered halfway along it and reaches the base's rim
+        volume = TILED_VOLUME_CONE;
+        size[0] = -2.0f * bounds[1];
+        size[1] = sqrtf(std::max(0.0f, bounds[3] * bounds[3] - bounds[1] * bounds[1]));
+    }
+    return tiledLighting.Add((TiledLightFalloff) tiledFalloff, volume, size, color, brightness, reach);
+}
+
+float RenderLight::Reach() const {
+    if(tiledFalloff < 0)
+        return -1.0f;
+    if(brightness <= 0.0f)
+        return 0.0f;
+
+    // Distances at which each shader's output drops below half a step of
+    // 8 bits, or to zero for those that subtract
+    const float threshold = .5f / 255.0f;
+    float peak = std::max(color[0], std::max(color[1], color[2]));
+    switch(tiledFalloff) {
+        case TILED_LIGHT_POINT: // min(b / d^2, 1.5) * color * albedo
+            return sqrtf(brightness * peak / threshold);
+        case TILED_LIGHT_SATURATING: // color * b / d^2 - .2
+            return sqrtf(brightness * peak / .2f);
+        case TILED_LIGHT_EXPLOSIVE: // color * (b / d^3 - 1) * albedo
+            return cbrtf(brightness);
+        case TILED_LIGHT_SPOT: // min(b * spot / d^2, 2) * color * albedo, with spot up to 2
+            return sqrtf(2.0f * brightness * peak / threshold);
+    }
+    return -1.0f;
+}
+
+void RenderLight::Execute(const DrawPacket & packet) {
+    for(int i = 0; i < 3; i++)
+        color[i] = packet.parameters[i];
+    brightness = packet.parameters[3];
+    Render();
 }
 
 void RenderLight::Render() {
+    PROFILE_ZONE("RenderLight::Render");
 
     if(!pipeline) {
         LOGE("RenderPipeline inaccessible.");
         exit(0);
     }
     
-    glUseProgram(colorShader);
-    checkGlError("glUseProgram");
+    if(!IsLoaded())
+        return;
     
-    glBindFramebuffer(GL_FRAMEBUFFER, defaultFrameBuffer);
-    glViewport(0, 0, displayWidth, displayHeight);
+    renderState.UseProgram(colorShader);
     
-    glEnable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA,GL_ONE);
-    glEnable(GL_DITHER);
+    pipeline->BindLightBuffer();
     
-    // Pass fragment size
-    GLuint u_FragWidth = glGetUniformLocation(colorShader, "u_FragWidth");
-    glUniform1i(u_FragWidth, displayWidth);
-    GLuint u_FragHeight = glGetUniformLocation(colorShader, "u_FragHeight");
-    glUniform1i(u_FragHeight, displayHeight);   
-    
-    // Pass color
-    GLuint colorUniform = glGetUniformLocation(colorShader, "u_Color");
-    glUniform3f(colorUniform, color[0], color[1], color[2]);
-    
-    // Pass brightness
-    GLuint brightnessUniform = glGetUniformLocation(colorShader, "u_Brightness");
-    glUniform1f(brightnessUniform, brightness);
+    renderState.Enable(GL_CULL_FACE, true);
+    renderState.Enable(GL_DEPTH_TEST, false);
+    renderState.Enable(GL_BLEND, true);
+    renderState.BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    renderState.Enable(GL_DITHER, true);
+
+    // The volume is usually looser than the falloff, so only pixels within
+    // the screen rectangle of the falloff's reach run the shader
+    float reach = Reach();
+    float rect[4];
+    if(reach >= 0.0f && screenRect(transforms.p(), transforms.mv().col(3).head<3>(), reach, rect)) {
+        int x0 = std::max(0, (int) floorf((.5f * rect[0] + .5f) * pipeline->width));
+        int y0 = std::max(0, (int) floorf((.5f * rect[1] + .5f) * pipeline->height));
+        int x1 = std::min(pipeline->width, (int) ceilf((.5f * rect[2] + .5f) * pipeline->width));
+        int y1 = std::min(pipeline->height, (int) ceilf((.5f * rect[3] + .5f) * pipeline->height));
+        if(x1 <= x0 || y1 <= y0)
+            return;
+        renderState.Enable(GL_SCISSOR_TEST, true);
+        renderState.Scissor(x0, y0, x1 - x0, y1 - y0);
+    }
     
-    // Pass matrices
-    GLfloat* mv_Matrix = (GLfloat*)mvMatrix();
-    GLfloat* mvp_Matrix = (GLfloat*)mvpMatrix();
-    GLfloat* pT_Matrix = (GLfloat*)pInverseMatrix();
-    glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mv_Matrix);
-    glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvp_Matrix);
-    GLuint gpT_MatrixHandle = glGetUniformLocation(colorShader, "u_pT_Matrix");
-    glUniformMatrix4fv(gpT_MatrixHandle, 1, GL_FALSE, pT_Matrix);
-    checkGlError("glUniformMatrix4fv");
-    delete[] mv_Matrix;
-    delete[] mvp_Matrix;
-    delete[] pT_Matrix;
+    if(uniformBuffers.IsEnabled()) {
+        // Fragment size and the inverse projection come with the frame block
+        uniformBuffers.SetObject(color, brightness);
+    } else {
+        // Pass fragment size
+        glUniform1i(fragWidthUniform, pipeline->width);
+        glUniform1i(fragHeightUniform, pipeline->height);
+
+        // Pass color
+        glUniform3f(colorUniform, color[0], color[1], color[2]);
+
+        // Pass brightness
+        glUniform1f(brightnessUniform, brightness);
+
+        // Pass matrices
+        glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mvMatrix());
+        glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvpMatrix());
+        glUniformMatrix4fv(pInverseUniform, 1, GL_FALSE, pInverseMatrix());
+        checkGlError("glUniformMatrix4fv");
+    }
     
-    glBindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
+    renderState.BindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
     
     // Pass vertices
     glEnableVertexAttribArray(gvPositionHandle);
@@ -68,20 +191,17 @@ void RenderLight::Render() {
     checkGlError("gvPositionHandle");
     
     // Pass g buffer
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, pipeline->gBuffer);
-    GLuint colorTextureUniform = glGetUniformLocation(colorShader, "u_gBuffer");
-    glUniform1i(colorTextureUniform, 0);
+    renderState.BindTexture(0, pipeline->gBuffer);
+    glUniform1i(gBufferUniform, 0);
     checkGlError("pass gBuffer");
     
-    glDrawArrays(GL_TRIANGLES, 0, numVertices);
-    checkGlError("glDrawArrays");
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Pass depth, if it's not in the g buffer's alpha
+    if(pipeline->depthTexture) {
+        renderState.BindTexture(1, pipeline->depthTexture);
+        glUniform1i(gDepthUniform, 1);
+        checkGlError("pass gDepth");
+    }
     
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    DrawMesh();
+    renderState.Enable(GL_SCISSOR_TEST, false); // Nothing else expects one
 }
@@ -18,8 +18,31 @@ public:
     RenderLight(const char *objFile, const char *vertexShaderFile, const char *fragmentShaderFile);
     void Render();
 
+    // Queues a draw in the lights pass, with the current color and
+    // brightness, or adds the light to tiledLighting's list if it can be
+    // shaded there
+    void Submit(int instance = 0);
+    void Execute(const DrawPacket & packet);
+
     float color[3]; // R, G, B (0.0, 1.0)
     float brightness; // (0, inf)
+
+protected:
+    // Adds this to the tiled light list, if that's in use and can shade it
+    bool SubmitTiled(float reach);
+    // View-space distance past which the falloff, at the current color and
+    // brightness, adds nothing an 8 bit target would show. Negative if the
+    // shader's falloff isn't known.
+    float Reach() const;
+
+    int tiledFalloff; // TiledLightFalloff the shader matches, or -1 if it's not known
+    GLuint fragWidthUniform;
+    GLuint fragHeightUniform;
+    GLuint colorUniform;
+    GLuint brightnessUniform;
+    GLuint pInverseUniform;
+    GLuint gBufferUniform;
+    GLuint gDepthUniform;
 };
 
 
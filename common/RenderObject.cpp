@@ -2,36 +2,157 @@
 //  nativeGraphics
 
 #include "RenderObject.h"
+
+#include <cstddef>
+#include <cstring>
+
 #include "RenderPipeline.h"
 #include "glsl_helper.h"
 #include "obj_parser.h"
+#include "AssetLoader.h"
 #include "transform.h"
+#include "UniformBuffers.h"
+#include "RenderState.h"
 #include "common.h"
 #include "log.h"
-#include "Timer.h"
 
-Timer timer;
+bool RenderObject::hardwareInstancing = false;
+
+static bool HardwareInstancingSupported() {
+#ifdef HARDWARE_INSTANCING
+#ifdef GLEW_ARB_instanced_arrays
+    // As in UniformBuffersSupported, trust the entry points over GLEW's flags.
+    if(!glDrawElementsInstanced || !glVertexAttribDivisor)
+        return false;
+#endif
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    glGetError(); // GL 2 doesn't know these queries
+#ifdef GL_ES_VERSION_3_0
+    return major >= 3;
+#else
+    return major > 3 || (major == 3 && minor >= 3);
+#endif
+#else
+    return false;
+#endif // HARDWARE_INSTANCING
+}
+
+void RenderObject::InitInstancing(bool allow) {
+    hardwareInstancing = allow && HardwareInstancingSupported();
+    if(hardwareInstancing) {
+        LOGI("Using hardware instancing");
+    }
+}
 
 RenderObject::RenderObject(const char *vertexShaderFilename, const char *fragmentShaderFilename, bool writegeometry) {
-    timer.reset();
     BasicInit(vertexShaderFilename, fragmentShaderFilename, writegeometry);
 }
 
 RenderObject::RenderObject(const char *objFilename, const char *vertexShaderFilename, const char *fragmentShaderFilename, bool writegeometry) {
     BasicInit(vertexShaderFilename, fragmentShaderFilename, writegeometry);
 
-    // Parse obj file into an interleaved float buffer
-    GLfloat * interleavedBuffer = getInterleavedBuffer((char *)loadResource(objFilename), numVertices, true, true);
     glGenBuffers(1, &gVertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, numVertices * (3+3+2) * sizeof(float), interleavedBuffer, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &gIndexBuffer);
+
+    AssetRequest * request = new AssetRequest(AssetRequest::MESH, objFilename, this);
+    if(assetLoader)
+        assetLoader->Request(request);
+    else
+        AssetLoader::LoadNow(request);
+}
+
+RenderObject::RenderObject() {
+    numVertices=0;
+    numIndices=0;
+    gVertexBuffer=0;
+    gIndexBuffer=0;
+    indexType=GL_UNSIGNED_SHORT;
+    pendingAssets=0;
+    colorShader=0;
+    geometryShader=-1;
+    texture=-1;
+    normalTexture=-1;
+    instancedShader=0;
+    gInstanceBuffer=0;
+    submittedInstances=0;
+    instanceFlushes=0;
+    cull=true;
+    bounds[0]=bounds[1]=bounds[2]=0.0f;
+    bounds[3]=-1.0f;
+}
+
+RenderObject::~RenderObject() {
+    if(assetLoader)
+        assetLoader->Cancel(this);
+}
+
+void RenderObject::UploadMesh(const GLfloat * vertexBuffer, const void * indices, int indexSize) {
+    renderState.BindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, numVertices * (3+3+2) * sizeof(float), vertexBuffer, GL_STATIC_DRAW);
+    renderState.BindBuffer(GL_ARRAY_BUFFER, 0);
     checkGlError("VertexBuffer Generation");
-    free(interleavedBuffer);
+
+    // 32-bit indices need GL_OES_element_index_uint on OpenGL ES 2.0
+    indexType = indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    renderState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * indexSize, indices, GL_STATIC_DRAW);
+    renderState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    checkGlError("IndexBuffer Generation");
+}
+
+// Draws the indexed mesh. Vertex attributes must already point at gVertexBuffer.
+void RenderObject::DrawMesh() {
+    renderState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIndexBuffer);
+    if(chunks.empty() || !cull) {
+        DrawIndices(0, numIndices);
+        return;
+    }
+
+    // Chunks that are next to each other in the index buffer and both in
+    // view are drawn together.
+    Frustum frustum;
+    frustum.Extract(transforms.mvp());
+    int first = 0, count = 0;
+    for(int i = 0; i < chunks.size(); i++) {
+        const MeshChunk & chunk = chunks[i];
+        if(!frustum.Intersects(Vector3f(chunk.bounds[0], chunk.bounds[1], chunk.bounds[2]), chunk.bounds[3]))
+            continue;
+        if(first + count == chunk.firstIndex) {
+            count += chunk.numIndices;
+            continue;
+        }
+        DrawIndices(first, count);
+        first = chunk.firstIndex;
+        count = chunk.numIndices;
+    }
+    DrawIndices(first, count);
+}
+
+// Draws count indices from first on. The index buffer must be bound.
+void RenderObject::DrawIndices(int first, int count) {
+    if(count == 0)
+        return;
+    int indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    glDrawElements(GL_TRIANGLES, count, indexType, (const GLvoid*)((size_t) first * indexSize));
+    checkGlError("glDrawElements");
 }
 
 void RenderObject::BasicInit(const char *vertexShaderFilename, const char *fragmentShaderFilename, bool writegeometry) {
     numVertices=0;
+    numIndices=0;
+    gVertexBuffer=0;
+    gIndexBuffer=0;
+    indexType=GL_UNSIGNED_SHORT;
+    pendingAssets=0;
+    instancedShader=0;
+    gInstanceBuffer=0;
+    submittedInstances=0;
+    instanceFlushes=0;
+    cull=true;
+    bounds[0]=bounds[1]=bounds[2]=0.0f;
+    bounds[3]=-1.0f;
     
     // Compile and link shader program
     const char * vertexShader = "standard_v.glsl";
@@ -49,29 +170,55 @@ void RenderObject::BasicInit(const char *vertexShaderFilename, const char *fragm
     normalTexture = -1;
 }
 
+// Looks up the handles below for shaderProgram. Draws only need to bind it.
 void RenderObject::SetShader(const GLuint shaderProgram) {
-    glUseProgram(shaderProgram);
-    checkGlError("glUseProgram");
+    renderState.UseProgram(shaderProgram);
+    LoadHandles(shaderProgram);
+}
+
+void RenderObject::LoadHandles(const GLuint shaderProgram) {
+    const ShaderLocations & locations = shaderLocations(shaderProgram);
+    gmvMatrixHandle = locations.Uniform("u_MVMatrix");
+    gmvpMatrixHandle = locations.Uniform("u_MVPMatrix");
+    gvPositionHandle = locations.Attribute("a_Position");
+    gvNormals = locations.Attribute("a_Normal");
+    gvTexCoords = locations.Attribute("a_TexCoordinate");
+    textureUniform = locations.Uniform("u_Texture");
+    normalMapUniform = locations.Uniform("u_NormalMap");
+    timeUniform = locations.Uniform("u_Time");
+}
+
+void RenderObject::EnableInstancing(const char *fragmentShaderFilename) {
+    instancedShader = createShaderProgram((char *)loadResource("instanced_v.glsl"), (char *)loadResource(fragmentShaderFilename));
+    if(!instancedShader)
+        return;
+
+    const ShaderLocations & locations = shaderLocations(instancedShader);
+    gInstanceMatrixHandle = locations.Attribute("a_InstanceMatrix");
+    gInstanceTimeHandle = locations.Attribute("a_InstanceTime");
+    gpMatrixHandle = locations.Uniform("u_PMatrix");
+    if(gInstanceMatrixHandle == -1) {
+        LOGE("RenderObject::EnableInstancing: a_InstanceMatrix not found.");
+        instancedShader = 0;
+        return;
+    }
 
-    gmvMatrixHandle = glGetUniformLocation(shaderProgram, "u_MVMatrix");
-    gmvpMatrixHandle = glGetUniformLocation(shaderProgram, "u_MVPMatrix");
-    gvPositionHandle = glGetAttribLocation(shaderProgram, "a_Position");
-    gvNormals = glGetAttribLocation(shaderProgram, "a_Normal");
-    gvTexCoords = glGetAttribLocation(shaderProgram, "a_TexCoordinate");
-    textureUniform = glGetUniformLocation(shaderProgram, "u_Texture");
-    normalMapUniform = glGetUniformLocation(shaderProgram, "u_NormalMap");
-    timeUniform = glGetUniformLocation(shaderProgram, "u_Time");
-    checkGlError("glGetAttribLocation");
+    glGenBuffers(1, &gInstanceBuffer);
 }
 
 void RenderObject::AddTexture(const char *textureFilename, bool normalmap) {
-    // Load textures
-    int width, height;
-    GLubyte *imageData = (GLubyte *)loadResource(textureFilename, &width, &height);
-    
+    AssetRequest * request = new AssetRequest(AssetRequest::TEXTURE, textureFilename, this);
+    request->normalMap = normalmap;
+    if(assetLoader)
+        assetLoader->Request(request);
+    else
+        AssetLoader::LoadNow(request);
+}
+
+void RenderObject::UploadTexture(const GLubyte * imageData, int width, int height, bool normalmap) {
     GLuint newTex = -1;
     glGenTextures(1, &newTex);
-    glBindTexture(GL_TEXTURE_2D, newTex);
+    renderState.BindTexture(0, newTex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -80,8 +227,7 @@ void RenderObject::AddTexture(const char *textureFilename, bool normalmap) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     
-    glBindTexture(GL_TEXTURE_2D, 0);
-    //free(imageData); // TODO: Not allowed on Samsung Galaxy (not malloc'd).
+    renderState.BindTexture(0, 0);
     
     checkGlError("AddTexture");
     
@@ -93,20 +239,31 @@ void RenderObject::AddTexture(const char *textureFilename, bool normalmap) {
 
 // Renders to the currently-active frame buffer.
 void RenderObject::RenderPass(int instance, GLfloat *buffer, int num) {
+    BindPass(buffer);
+
+    if(buffer != NULL) {
+        glDrawArrays(GL_TRIANGLES, 0, num);
+        checkGlError("glDrawArrays");
+    } else {
+        DrawMesh();
+    }
+}
+
+void RenderObject::BindPass(GLfloat *buffer) {
 
     // Pass matrices
-    GLfloat* mv_Matrix = (GLfloat*)mvMatrix();
-    GLfloat* mvp_Matrix = (GLfloat*)mvpMatrix();
-    glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mv_Matrix);
-    glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvp_Matrix);
-    checkGlError("glUniformMatrix4fv");
-    delete[] mv_Matrix;
-    delete[] mvp_Matrix;
+    if(uniformBuffers.IsEnabled())
+        uniformBuffers.SetObject();
+    else {
+        glUniformMatrix4fv(gmvMatrixHandle, 1, GL_FALSE, mvMatrix());
+        glUniformMatrix4fv(gmvpMatrixHandle, 1, GL_FALSE, mvpMatrix());
+        checkGlError("glUniformMatrix4fv");
+    }
     
     if(buffer != NULL)
-        glBindBuffer(GL_ARRAY_BUFFER, 0); // Don't use vertex buffer
+        renderState.BindBuffer(GL_ARRAY_BUFFER, 0); // Don't use vertex buffer
     else
-        glBindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
+        renderState.BindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
     
     // Pass vertices
     glEnableVertexAttribArray(gvPositionHandle);
@@ -129,60 +286,190 @@ void RenderObject::RenderPass(int instance, GLfloat *buffer, int num) {
     
     // Pass texture
     if(textureUniform != -1 && texture != -1) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        renderState.BindTexture(0, texture);
         glUniform1i(textureUniform, 0);
         checkGlError("texture");
     }
     
     if(timeUniform != -1)
-        glUniform1f(timeUniform, timer.getSeconds());
+        glUniform1f(timeUniform, simClock.RenderTime());
 
     // Pass normal map
     if(normalMapUniform != -1 && normalTexture != -1) {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normalTexture);
+        renderState.BindTexture(1, normalTexture);
         glUniform1i(textureUniform, 1);
         checkGlError("normalTexture");
     }
-    
-    if(buffer != NULL)
-        glDrawArrays(GL_TRIANGLES, 0, num);
+}
+
+bool RenderObject::InView(int numPlanes) {
+    if(!cull || bounds[3] < 0.0f)
+        return true;
+    Frustum frustum;
+    frustum.Extract(transforms.mvp());
+    return frustum.Intersects(Vector3f(bounds[0], bounds[1], bounds[2]), bounds[3], numPlanes);
+}
+
+void RenderObject::Submit(int instance) {
+    if(!InView())
+        return;
+
+    // View depth, so the geometry pass draws front to back
+    float depth = -transforms.mv()(2, 3);
+    renderQueue.Submit(this, RenderQueue::Key(DRAW_PASS_GEOMETRY, colorShader, texture, depth), instance);
+}
+
+void RenderObject::Execute(const DrawPacket & packet) {
+    if(packet.instanceCount)
+        RenderInstances(packet.instance, packet.instanceCount);
     else
-        glDrawArrays(GL_TRIANGLES, 0, numVertices);
+        Render(packet.instance);
+}
+
+void RenderObject::AddInstance(const float * model, float time, int instance) {
+    InstanceAttributes * attributes = AddInstances(&instance, 1);
+    memcpy(attributes->model, model, sizeof(attributes->model));
+    attributes->time = time;
+}
+
+InstanceAttributes * RenderObject::AddInstances(const int * indices, int count) {
+    // Packets from before the last flush have been drawn
+    if(instanceFlushes != renderQueue.Flushes()) {
+        instanceAttributes.clear();
+        instanceIndices.clear();
+        submittedInstances = 0;
+        instanceFlushes = renderQueue.Flushes();
+    }
+
+    int first = instanceAttributes.size();
+    instanceAttributes.resize(first + count);
+    instanceIndices.insert(instanceIndices.end(), indices, indices + count);
+    return count ? &instanceAttributes[first] : NULL;
+}
 
-    checkGlError("glDrawArrays");
+void RenderObject::SubmitInstances() {
+    int first = submittedInstances;
+    int count = instanceAttributes.size() - first;
+    if(instanceFlushes != renderQueue.Flushes() || count <= 0)
+        return;
+    submittedInstances += count;
+
+    if(!instancedShader) {
+        for(int i = first; i < first + count; i++) {
+            mvPushMatrix();
+            model_view.multiply(Eigen::Map<const Matrix4f>(instanceAttributes[i].model));
+            Submit(instanceIndices[i]);
+            mvPopMatrix();
+        }
+        return;
+    }
 
+    float depth = -transforms.mv()(2, 3);
+    DrawPacket & packet = renderQueue.Submit(this, RenderQueue::Key(DRAW_PASS_GEOMETRY, instancedShader, texture, depth), first);
+    packet.instanceCount = count;
+}
+
+void RenderObject::RenderInstances(int first, int count) {
+    if(!BeginGeometryPass(instancedShader))
+        return;
+
+    // Point the handles BindPass uses at the instanced shader for the draw
+    LoadHandles(instancedShader);
+    BindPass(NULL);
+    if(!uniformBuffers.IsEnabled()) {
+        glUniformMatrix4fv(gpMatrixHandle, 1, GL_FALSE, pMatrix());
+        checkGlError("glUniformMatrix4fv");
+    }
+
+    const InstanceAttributes * attributes = &instanceAttributes[first];
+    if(hardwareInstancing) {
+#ifdef HARDWARE_INSTANCING
+        renderState.BindBuffer(GL_ARRAY_BUFFER, gInstanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceAttributes), attributes, GL_STREAM_DRAW);
+        for(int column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(gInstanceMatrixHandle + column);
+            glVertexAttribPointer(gInstanceMatrixHandle + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceAttributes),
+                                  (const GLvoid*)(offsetof(InstanceAttributes, model) + 4 * column * sizeof(GLfloat)));
+            glVertexAttribDivisor(gInstanceMatrixHandle + column, 1);
+        }
+        if(gInstanceTimeHandle != -1) {
+            glEnableVertexAttribArray(gInstanceTimeHandle);
+            glVertexAttribPointer(gInstanceTimeHandle, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceAttributes),
+                                  (const GLvoid*)offsetof(InstanceAttributes, time));
+            glVertexAttribDivisor(gInstanceTimeHandle, 1);
+        }
+        checkGlError("instance attributes");
+
+        renderState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIndexBuffer);
+        glDrawElementsInstanced(GL_TRIANGLES, numIndices, indexType, 0, count);
+        checkGlError("glDrawElementsInstanced");
+
+        // Divisors belong to the locations, not the program, so put them
+        // back for whichever shader uses these locations next.
+        for(int column = 0; column < 4; column++) {
+            glVertexAttribDivisor(gInstanceMatrixHandle + column, 0);
+            glDisableVertexAttribArray(gInstanceMatrixHandle + column);
+        }
+        if(gInstanceTimeHandle != -1) {
+            glVertexAttribDivisor(gInstanceTimeHandle, 0);
+            glDisableVertexAttribArray(gInstanceTimeHandle);
+        }
+#endif // HARDWARE_INSTANCING
+    } else {
+        // Pseudo-instancing: with their arrays disabled, the instance
+        // attributes are constants, which are cheaper to change between
+        // draws than uniforms.
+        for(int column = 0; column < 4; column++)
+            glDisableVertexAttribArray(gInstanceMatrixHandle + column);
+        if(gInstanceTimeHandle != -1)
+            glDisableVertexAttribArray(gInstanceTimeHandle);
+
+        // Whole meshes: culling chunks would go by the shared model-view
+        // rather than each instance's
+        renderState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIndexBuffer);
+        for(int i = 0; i < count; i++) {
+            for(int column = 0; column < 4; column++)
+                glVertexAttrib4fv(gInstanceMatrixHandle + column, attributes[i].model + 4 * column);
+            if(gInstanceTimeHandle != -1)
+                glVertexAttrib1f(gInstanceTimeHandle, attributes[i].time);
+            DrawIndices(0, numIndices);
+        }
+    }
+
+    LoadHandles(colorShader);
 }
 
 void RenderObject::Render(int instance, GLfloat *buffer, int num) {
+    if(!BeginGeometryPass(colorShader))
+        return;
+    RenderPass(instance, buffer, num);
+}
+
+bool RenderObject::BeginGeometryPass(GLuint program) {
 
     if(!pipeline) {
         LOGE("RenderPipeline inaccessible.");
         exit(0);
     }
     
+    if(!IsLoaded())
+        return false;
+    
     //////////////////////////////////
     // Render to frame buffer
     
     // Render to gbuffer (R, G, B, UNUSED / Depth_MVP)
-    SetShader(colorShader);
+    renderState.UseProgram(program);
     
-    glBindFramebuffer(GL_FRAMEBUFFER, pipeline->frameBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pipeline->gBuffer, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pipeline->depthBuffer);
-    glViewport(0, 0, displayWidth, displayHeight);
-    
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    glDepthFunc(GL_LESS);
-    glEnable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glDisable(GL_DITHER);
-    checkGlError("glClear");
-    
-    RenderPass(instance, buffer, num);
+    pipeline->BindGBuffer();
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0); // TODO: unbind other resources
+    renderState.Enable(GL_DEPTH_TEST, true);
+    renderState.DepthMask(GL_TRUE);
+    renderState.DepthFunc(GL_LESS);
+    renderState.Enable(GL_CULL_FACE, true);
+    renderState.Enable(GL_BLEND, false);
+    renderState.Enable(GL_DITHER, false);
+    checkGlError("glClear");
+    return true;
 }
 
@@ -8,12 +8,28 @@
 #include <string>
 
 #include "graphics_header.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "MeshChunks.h"
 
 #include <vector>
 
 using namespace std;
 
-class RenderObject {
+// glDrawElementsInstanced and glVertexAttribDivisor need GL 3.3 or GLES 3.
+// The GLES2 headers used on Android and iOS declare neither, so there
+// instances are drawn one at a time with their attributes set as constants.
+#if defined(GL_VERTEX_ATTRIB_ARRAY_DIVISOR) && !defined(ANDROID_NDK)
+#define HARDWARE_INSTANCING
+#endif
+
+// One instance's attributes, as laid out in the instance buffer
+struct InstanceAttributes {
+    GLfloat model[16]; // a_InstanceMatrix, column-major
+    GLfloat time; // a_InstanceTime
+};
+
+class RenderObject : public Drawable {
 public:
     // Basic constructor (no geometry)
     RenderObject(const char *vertexShaderFile, const char *fragmentShaderFile, bool writegeometry = true);
@@ -21,20 +37,80 @@ public:
     // Constructor with geometry
     RenderObject(const char *objFile, const char *vertexShaderFile, const char *fragmentShaderFile, bool writegeometry = true);
 
+    virtual ~RenderObject();
+
     // Add a texture or normal map
     void AddTexture(const char *textureFilename, bool normalmap = false);
 
     // Render color and geometry to g buffer
     void Render(int instance = 0, GLfloat *buffer = 0, int num = -1);
 
+    // Queues a draw with the current transform, to be made by
+    // renderQueue.Flush. Goes in the geometry pass unless overridden.
+    virtual void Submit(int instance = 0);
+
+    // Makes a draw queued by Submit. The packet's transform is already loaded.
+    virtual void Execute(const DrawPacket & packet);
+
+    // Instancing: many copies of the mesh, each with its own model matrix
+    // (applied after the model-view at submission) and animation time. Add
+    // them one by one, then SubmitInstances queues a single packet drawing
+    // all those added since. Without an instanced shader, each instance is
+    // submitted on its own instead.
+    void AddInstance(const float * model, float time, int instance);
+    void SubmitInstances();
+    // Room for count instances at once, to be filled in before the next
+    // AddInstance(s). indices says which instance each one is.
+    InstanceAttributes * AddInstances(const int * indices, int count);
+
+    // Whether to draw instances with glDrawElementsInstanced where it's
+    // supported. Call before any objects are created.
+    static void InitInstancing(bool allow);
+
+    // False while the mesh or textures are still loading in the background
+    bool IsLoaded() const { return pendingAssets == 0; }
+
+    // Whether Submit skips the object when its mesh's bounds are outside the
+    // view frustum. Turn off for meshes the model-view doesn't place, like
+    // full-screen quads.
+    bool cull;
+
     GLuint colorShader;
     GLuint geometryShader; // NULL, except when a custom v shader is specified.
 
 protected:
+    friend class AssetLoader;
+
+    // Simulation only: no shaders, buffers or any other GL calls, so
+    // subclasses can run their CPU-side updates without a context (e.g. in
+    // benchmarks). Such objects must not be rendered.
+    RenderObject();
+
     void BasicInit(const char *vertexShaderFilename, const char *fragmentShaderFilename, bool writegeometry);
     void SetShader(const GLuint shaderProgram);
+    void LoadHandles(const GLuint shaderProgram); // SetShader, without binding it
+    void UploadMesh(const GLfloat * vertexBuffer, const void * indices, int indexSize);
+    void UploadTexture(const GLubyte * imageData, int width, int height, bool normalmap);
+    void DrawMesh(); // Only the chunks in view, if the mesh was split up
+    void DrawIndices(int first, int count);
+
+    // Whether the mesh's bounding sphere, placed by the current model-view,
+    // reaches inside the first numPlanes planes of the view frustum. Always
+    // true if cull is off or the mesh hasn't loaded.
+    bool InView(int numPlanes = FRUSTUM_PLANES);
     virtual void RenderPass(int instance, GLfloat *buffer, int num);
 
+    // Binds the g buffer and its state for drawing with program. False if
+    // the object isn't ready to be drawn.
+    bool BeginGeometryPass(GLuint program);
+    // Sets everything RenderPass draws with, bar the draw call itself
+    void BindPass(GLfloat *buffer);
+
+    // Compiles instanced_v.glsl with the given fragment shader, for
+    // SubmitInstances. Only for objects using the standard vertex shader.
+    void EnableInstancing(const char *fragmentShaderFilename);
+    void RenderInstances(int first, int count);
+
     GLuint gvPositionHandle;
     GLuint gmvMatrixHandle;
     GLuint gmvpMatrixHandle;
@@ -42,12 +118,30 @@ protected:
     GLuint gvTexCoords;
     GLuint gvNormals;
     GLuint gVertexBuffer;
+    GLuint gIndexBuffer;
     GLuint normalMapUniform;
     GLuint timeUniform;
 
     GLuint texture;
     GLuint normalTexture;
     int numVertices;
+    int numIndices;
+    GLenum indexType;
+    int pendingAssets;
+    float bounds[4]; // Bounding sphere of the mesh: center, then radius (< 0 until loaded)
+    vector<MeshChunk> chunks; // In index buffer order, if the mesh was split up
+
+    GLuint instancedShader; // 0 unless EnableInstancing succeeded
+    GLint gInstanceMatrixHandle; // Four locations, one per column
+    GLint gInstanceTimeHandle;
+    GLint gpMatrixHandle;
+    GLuint gInstanceBuffer;
+    vector<InstanceAttributes> instanceAttributes;
+    vector<int> instanceIndices; // Which instance each of the above is
+    int submittedInstances; // Already queued by SubmitInstances
+    unsigned int instanceFlushes; // renderQueue.Flushes() when they were added
+
+    static bool hardwareInstancing;
 };
 
 
@@ -5,86 +5,324 @@
 
 #include "common.h"
 #include "glsl_helper.h"
+#include "Profiler.h"
+#include "RenderState.h"
+#include "transform.h"
 #include "log.h"
 #include "cmath"
+#include <string.h>
+#include <algorithm>
+#include <string>
 
 #include "Eigen/Eigenvalues"
 
 using Eigen::Vector3f;
 
-RenderPipeline::RenderPipeline() {
+#if defined(ANDROID_NDK) || (defined(__APPLE__) && !defined(ARCH_Darwin))
+#define DEPTH_TEXTURE_ES // Needs GLES 3 or OES_depth_texture
+#define HALF_FLOAT_ES // Needs OES_texture_half_float and EXT_color_buffer_half_float
+#endif
+
+static bool DepthTexturesSupported() {
+#ifdef DEPTH_TEXTURE_ES
+    const char * version = (const char *) glGetString(GL_VERSION);
+    const char * extensions = (const char *) glGetString(GL_EXTENSIONS);
+    return (version && strncmp(version, "OpenGL ES 3", 11) == 0) ||
+           (extensions && strstr(extensions, "GL_OES_depth_texture"));
+#else
+    return true;
+#endif
+}
+
+#ifndef GL_HALF_FLOAT_OES
+#define GL_HALF_FLOAT_OES 0x8D61 // Not in the iOS ES2 headers
+#endif
+
+static bool HalfFloatTargetsSupported() {
+#ifdef HALF_FLOAT_ES
+    // Textures, then rendering and blending to them
+    const char * extensions = (const char *) glGetString(GL_EXTENSIONS);
+    return extensions && strstr(extensions, "GL_OES_texture_half_float") &&
+           strstr(extensions, "GL_EXT_color_buffer_half_float");
+#else
+    return true;
+#endif
+}
+
+static int scaledSize(int size, float scale) {
+    return std::max(1, (int) floorf(size * scale + .5f));
+}
+
+RenderPipeline::RenderPipeline(bool preciseDepth, float renderScale) {
     
     defaultFrameBuffer = 0;
+    depthBuffer = 0;
+    depthTexture = 0;
+    compositeQueued = false;
+    this->renderScale = std::min(1.0f, std::max(RENDER_SCALE_MIN, renderScale));
+    width = scaledSize(displayWidth, this->renderScale);
+    height = scaledSize(displayHeight, this->renderScale);
+    
+    // Covers the viewport
+    const GLfloat square[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenBuffers(1, &squareVertices);
+    renderState.BindBuffer(GL_ARRAY_BUFFER, squareVertices);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(square), square, GL_STATIC_DRAW);
     
     // Allocate frame buffer
     glGenFramebuffers(1, &frameBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    
-    // Allocate depth buffer
-    glGenRenderbuffers(1, &depthBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, displayWidth, displayHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    renderState.BindFramebuffer(frameBuffer);
     
     // Allocate albedo texture to render to.
     glGenTextures(1, &gBuffer);
-    glBindTexture(GL_TEXTURE_2D, gBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, displayWidth, displayHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    renderState.BindTexture(0, gBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     checkGlError("gBuffer");
+    renderState.FramebufferTexture(GL_COLOR_ATTACHMENT0, gBuffer);
+    
+    if(!preciseDepth || !DepthTexturesSupported() || !CreateDepthTexture()) {
+        // Allocate depth buffer
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+        renderState.FramebufferRenderbuffer(GL_DEPTH_ATTACHMENT, depthBuffer);
+    }
+    
+    // Both decide what the shaders compiled from here on see
+    CreateLightBuffer();
+    composite.Create(false);
+    upsample.Create(true);
     
-    glBindTexture(GL_TEXTURE_2D, 0);       
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    renderState.BindTexture(0, 0);
+    renderState.BindFramebuffer(0);
 }
 
-inline int clamp(int x, int a, int b) {
-    return x < a ? a : (x > b ? b : x);
+static void depthTextureImage(int width, int height) {
+#ifdef DEPTH_TEXTURE_ES
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+#else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+#endif
 }
 
-uint8_t RenderPipeline::getDepth(float x, float y) {
-
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gBuffer, 0);
-        
-    int xpixel = clamp((int) floor(x * displayWidth), 0, displayWidth - 1);
-    int ypixel = clamp((int) floor(y * displayHeight), 0, displayHeight - 1);
+bool RenderPipeline::CreateDepthTexture() {
+    glGetError(); // Only errors from here on mean it failed
+    glGenTextures(1, &depthTexture);
+    renderState.BindTexture(0, depthTexture);
+    depthTextureImage(width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    renderState.FramebufferTexture(GL_DEPTH_ATTACHMENT, depthTexture);
     
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    checkGlError("glPixelStorei");
+    if(glGetError() != GL_NO_ERROR || glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOGI("Depth textures unusable, keeping depth in the g buffer's alpha");
+        renderState.FramebufferTexture(GL_DEPTH_ATTACHMENT, 0);
+        glDeleteTextures(1, &depthTexture);
+        depthTexture = 0;
+        return false;
+    }
     
-    uint8_t data[4];
-    glReadPixels(xpixel, ypixel, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &data);
-    checkGlError("glReadPixels");
+    depthPackShader = createShaderProgram((char *)loadResource("dr_square_v.glsl"), (char *)loadResource("depth_pack_f.glsl"));
+    const ShaderLocations & locations = shaderLocations(depthPackShader);
+    depthPackPosition = locations.Attribute("a_Position");
+    depthPackTexture = locations.Uniform("u_gDepth");
+    depthPackOffset = locations.Uniform("u_Offset");
+    depthPackTexelSize = locations.Uniform("u_TexelSize");
+    
+    glGenTextures(1, &depthReadTexture);
+    renderState.BindTexture(0, depthReadTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, DEPTH_READ_SIZE, DEPTH_READ_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glGenFramebuffers(1, &depthReadBuffer);
+    renderState.BindFramebuffer(depthReadBuffer);
+    renderState.FramebufferTexture(GL_COLOR_ATTACHMENT0, depthReadTexture);
+    checkGlError("depthReadBuffer");
+    
+    defineShaderMacro("PRECISE_DEPTH");
+    LOGI("Using a depth texture for the g buffer");
+    return true;
+}
+
+void RenderPipeline::CreateLightBuffer() {
+    glGenTextures(1, &lightBuffer);
+    renderState.BindTexture(0, lightBuffer);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glGenFramebuffers(1, &lightFrameBuffer);
+    renderState.BindFramebuffer(lightFrameBuffer);
+    defineShaderMacro("LIGHT_MAX", LIGHT_MAX);
     
-    return data[3];
+    if(HalfFloatTargetsSupported()) {
+        glGetError(); // Only errors from here on mean it failed
+#ifdef HALF_FLOAT_ES
+        lightBufferFormat = GL_RGBA;
+        lightBufferType = GL_HALF_FLOAT_OES;
+#else
+        lightBufferFormat = GL_RGBA16F;
+        lightBufferType = GL_HALF_FLOAT;
+#endif
+        glTexImage2D(GL_TEXTURE_2D, 0, lightBufferFormat, width, height, 0, GL_RGBA, lightBufferType, NULL);
+        renderState.FramebufferTexture(GL_COLOR_ATTACHMENT0, lightBuffer);
+        if(glGetError() == GL_NO_ERROR && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+            defineShaderMacro("LIGHT_SCALE", 1.0f);
+            LOGI("Accumulating light in half float");
+            return;
+        }
+    }
+    
+    lightBufferFormat = GL_RGBA;
+    lightBufferType = GL_UNSIGNED_BYTE;
+    glTexImage2D(GL_TEXTURE_2D, 0, lightBufferFormat, width, height, 0, GL_RGBA, lightBufferType, NULL);
+    renderState.FramebufferTexture(GL_COLOR_ATTACHMENT0, lightBuffer);
+    checkGlError("lightBuffer");
+    defineShaderMacro("LIGHT_SCALE", 1.0f / LIGHT_BUFFER_RANGE);
+    LOGI("Accumulating light in 8 bits, up to %g", LIGHT_BUFFER_RANGE);
+}
+
+void RenderPipeline::CompositeProgram::Create(bool upsample) {
+    std::string source = (char *)loadResource("composite_f.glsl");
+    if(upsample)
+        source = "#define UPSAMPLE\n" + source;
+    program = createShaderProgram((char *)loadResource("dr_square_v.glsl"), source.c_str());
+    const ShaderLocations & locations = shaderLocations(program);
+    position = locations.Attribute("a_Position");
+    lightBuffer = locations.Uniform("u_LightBuffer");
+    gBuffer = locations.Uniform("u_gBuffer");
+    depth = locations.Uniform("u_gDepth");
+    sourceSize = locations.Uniform("u_SourceSize");
+    texelSize = locations.Uniform("u_TexelSize");
+    depthParams = locations.Uniform("u_DepthParams");
+}
+
+void RenderPipeline::AllocateBuffers() {
+    renderState.BindTexture(0, gBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    if(depthTexture) {
+        renderState.BindTexture(0, depthTexture);
+        depthTextureImage(width, height);
+    } else {
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    }
+    renderState.BindTexture(0, lightBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, lightBufferFormat, width, height, 0, GL_RGBA, lightBufferType, NULL);
+    renderState.BindTexture(0, 0);
+    checkGlError("RenderPipeline::AllocateBuffers");
 }
 
-Eigen::Vector3f RenderPipeline::getNormal(float x, float y, Eigen::Matrix4f mvp) {
+void RenderPipeline::SetRenderScale(float scale) {
+    renderScale = std::min(1.0f, std::max(RENDER_SCALE_MIN, scale));
+    int newWidth = scaledSize(displayWidth, renderScale);
+    int newHeight = scaledSize(displayHeight, renderScale);
+    if(newWidth == width && newHeight == height)
+        return;
+    width = newWidth;
+    height = newHeight;
+    AllocateBuffers();
+}
 
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gBuffer, 0);
-        
-    int xpixel = clamp((int) floor(x * displayWidth), 0, displayWidth - 6);
-    int ypixel = clamp((int) floor(y * displayHeight), 0, displayHeight - 6);
+bool RenderPipeline::Scaled() const {
+    return width != displayWidth || height != displayHeight;
+}
+
+void RenderPipeline::BindGBuffer() {
+    renderState.BindFramebuffer(frameBuffer);
+    renderState.FramebufferTexture(GL_COLOR_ATTACHMENT0, gBuffer);
+    if(depthTexture)
+        renderState.FramebufferTexture(GL_DEPTH_ATTACHMENT, depthTexture);
+    else
+        renderState.FramebufferRenderbuffer(GL_DEPTH_ATTACHMENT, depthBuffer);
+    renderState.Viewport(0, 0, width, height);
+}
+
+void RenderPipeline::BindLightBuffer() {
+    renderState.BindFramebuffer(lightFrameBuffer);
+    renderState.Viewport(0, 0, width, height);
+}
+
+inline int clamp(int x, int a, int b) {
+    return x < a ? a : (x > b ? b : x);
+}
+
+void RenderPipeline::readDepths(int x, int y, int width, int height, float * depths) {
     
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
     checkGlError("glPixelStorei");
     
-    uint8_t data[4];
-    glReadPixels(xpixel, ypixel, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &data);
-    checkGlError("glReadPixels");
-    Eigen::Vector4f pos0 = mvp.inverse() * Eigen::Vector4f(2.0f * xpixel / (float) displayWidth - 1, 2.0f * ypixel / (float) displayHeight - 1, data[3] / 128.0f - 1.0f, 1.0);
+    uint8_t data[DEPTH_READ_SIZE * DEPTH_READ_SIZE * 4];
     
-    glReadPixels(xpixel + 5, ypixel, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &data);
-    checkGlError("glReadPixels");
-    Eigen::Vector4f pos1 = mvp.inverse() * Eigen::Vector4f(2.0f * (xpixel+5) / (float) displayWidth - 1, 2.0f * ypixel / (float) displayHeight - 1, data[3] / 128.0f - 1.0f, 1.0);
+    if(!depthTexture) {
+        // The alpha is MVP depth, clamped to [0, 1] when it was written
+        renderState.BindFramebuffer(frameBuffer);
+        renderState.FramebufferTexture(GL_COLOR_ATTACHMENT0, gBuffer);
+        glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        checkGlError("glReadPixels");
+        for(int i = 0; i < width * height; i++)
+            depths[i] = .5f * (data[i * 4 + 3] / 255.0f + 1.0f);
+        return;
+    }
     
-    glReadPixels(xpixel, ypixel + 5, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &data);
+    // Pack the block's depths into the bottom left of depthReadTexture
+    renderState.UseProgram(depthPackShader);
+    renderState.BindFramebuffer(depthReadBuffer);
+    renderState.Viewport(0, 0, width, height);
+    renderState.Enable(GL_DEPTH_TEST, false);
+    renderState.Enable(GL_CULL_FACE, false);
+    renderState.Enable(GL_BLEND, false);
+    renderState.Enable(GL_DITHER, false);
+    
+    renderState.BindTexture(0, depthTexture);
+    glUniform1i(depthPackTexture, 0);
+    glUniform2f(depthPackOffset, (float) x, (float) y);
+    glUniform2f(depthPackTexelSize, 1.0f / this->width, 1.0f / this->height);
+    
+    renderState.BindBuffer(GL_ARRAY_BUFFER, squareVertices);
+    glEnableVertexAttribArray(depthPackPosition);
+    glVertexAttribPointer(depthPackPosition, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid*) 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    renderState.BindTexture(0, 0); // Don't leave it where the geometry pass might sample it
+    checkGlError("depth pack");
+    
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
     checkGlError("glReadPixels");
-    Eigen::Vector4f pos2 = mvp.inverse() * Eigen::Vector4f(2.0f * xpixel / (float) displayWidth - 1, 2.0f * (ypixel+5) / (float) displayHeight - 1, data[3] / 128.0f - 1.0f, 1.0);
+    for(int i = 0; i < width * height; i++) {
+        const uint8_t * packed = data + i * 4;
+        float depth = packed[0] / 255.0f + packed[1] / 65025.0f + packed[2] / 16581375.0f;
+        depths[i] = depth < 1.0f ? depth : 1.0f;
+    }
+}
+
+float RenderPipeline::getDepth(float x, float y) {
+    
+    int xpixel = clamp((int) floor(x * width), 0, width - 1);
+    int ypixel = clamp((int) floor(y * height), 0, height - 1);
+    
+    float depth;
+    readDepths(xpixel, ypixel, 1, 1, &depth);
+    return depth;
+}
+
+Eigen::Vector3f RenderPipeline::getNormal(float x, float y, const Eigen::Matrix4f & mvpInverse) {
+    
+    int xpixel = clamp((int) floor(x * width), 0, width - 6);
+    int ypixel = clamp((int) floor(y * height), 0, height - 6);
+    
+    // Three corners of a 6 x 6 block
+    float depths[6 * 6];
+    readDepths(xpixel, ypixel, 6, 6, depths);
+    
+    Eigen::Vector4f pos0 = mvpInverse * Eigen::Vector4f(2.0f * xpixel / (float) width - 1, 2.0f * ypixel / (float) height - 1, 2.0f * depths[0] - 1.0f, 1.0);
+    Eigen::Vector4f pos1 = mvpInverse * Eigen::Vector4f(2.0f * (xpixel+5) / (float) width - 1, 2.0f * ypixel / (float) height - 1, 2.0f * depths[5] - 1.0f, 1.0);
+    Eigen::Vector4f pos2 = mvpInverse * Eigen::Vector4f(2.0f * xpixel / (float) width - 1, 2.0f * (ypixel+5) / (float) height - 1, 2.0f * depths[5 * 6] - 1.0f, 1.0);
     
     Eigen::Vector4f cross0t = pos0 / pos0(3) - pos1 / pos1(3);
     Vector3f cross0 = Vector3f(cross0t(0), cross0t(1), cross0t(2));
@@ -97,16 +335,58 @@ Eigen::Vector3f RenderPipeline::getNormal(float x, float y, Eigen::Matrix4f mvp)
 
 void RenderPipeline::ClearBuffers() {
     
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gBuffer, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    BindGBuffer();
+    renderState.DepthMask(GL_TRUE); // glClear respects both
+    renderState.Enable(GL_SCISSOR_TEST, false);
     glClearColor(0., 0., 0., 1.);
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     checkGlError("glClear");
     
-    glBindFramebuffer(GL_FRAMEBUFFER, defaultFrameBuffer);
+    renderState.BindFramebuffer(lightFrameBuffer);
+    glClear(GL_COLOR_BUFFER_BIT);
+    renderState.BindFramebuffer(defaultFrameBuffer);
     glClear(GL_COLOR_BUFFER_BIT);
     checkGlError("glClear");
+    compositeQueued = false;
+}
+
+void RenderPipeline::SubmitComposite() {
+    if(compositeQueued)
+        return;
+    renderQueue.Submit(this, RenderQueue::Key(DRAW_PASS_COMPOSITE, composite.program));
+    compositeQueued = true;
+}
+
+void RenderPipeline::Execute(const DrawPacket & packet) {
+    PROFILE_ZONE("RenderPipeline::Composite");
+    
+    const CompositeProgram & program = Scaled() ? upsample : composite;
+    renderState.UseProgram(program.program);
+    renderState.BindFramebuffer(defaultFrameBuffer);
+    renderState.Viewport(0, 0, displayWidth, displayHeight);
+    renderState.Enable(GL_DEPTH_TEST, false);
+    renderState.Enable(GL_CULL_FACE, false);
+    renderState.Enable(GL_BLEND, false);
+    renderState.Enable(GL_DITHER, true);
+    
+    renderState.BindTexture(0, lightBuffer);
+    glUniform1i(program.lightBuffer, 0);
+    glUniform2f(program.sourceSize, (float) width, (float) height);
+    glUniform2f(program.texelSize, 1.0f / displayWidth, 1.0f / displayHeight);
+    if(Scaled()) {
+        renderState.BindTexture(1, gBuffer);
+        glUniform1i(program.gBuffer, 1);
+        if(depthTexture) {
+            renderState.BindTexture(2, depthTexture);
+            glUniform1i(program.depth, 2);
+        }
+        // View distance is p(2, 3) / (NDC depth + p(2, 2)) under a perspective projection
+        glUniform2f(program.depthParams, transforms.p()(2, 2), transforms.p()(2, 3));
+    }
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    renderState.BindBuffer(GL_ARRAY_BUFFER, squareVertices);
+    glEnableVertexAttribArray(program.position);
+    glVertexAttribPointer(program.position, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid*) 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    checkGlError("RenderPipeline::Execute");
 }
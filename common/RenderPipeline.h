@@ -5,22 +5,113 @@
 #define __nativeGraphics__RenderPipeline__
 
 #include "graphics_header.h"
+#include "RenderQueue.h"
 
 #include "Eigen/Core"
 
-class RenderPipeline {
+// Pixels on a side of the block that picking resolves depth for at once
+#define DEPTH_READ_SIZE 8
+// Smallest fraction of the display's size the g buffer can be drawn at
+#define RENDER_SCALE_MIN .5f
+// Light accumulates past 1 for the composite to tonemap, but each light
+// stops at this, which already comes out white, to keep sums finite
+#define LIGHT_MAX 16.0f
+// Brightest light an 8 bit light buffer holds. Light shaders multiply what
+// they write by LIGHT_SCALE, the inverse of this there and 1 in half float,
+// and the composite divides it back out. Shaders compiled after the pipeline
+// see both LIGHT_MAX and LIGHT_SCALE defined.
+#define LIGHT_BUFFER_RANGE 4.0f
+
+// Lights accumulate unclamped in a light buffer: half float where that can
+// be rendered to and blended, otherwise 8 bits scaled down by
+// LIGHT_BUFFER_RANGE for some headroom. One composite pass then tonemaps it
+// to defaultFrameBuffer, before the overlay. The g buffer and light buffer
+// are drawn at renderScale times the display's size, and below 1 the
+// composite scales them up.
+class RenderPipeline : public Drawable {
 public:
 
-    RenderPipeline();
+    // With preciseDepth, and where depth textures are supported, depth goes
+    // to a texture that lights and picking read at full precision. Otherwise
+    // both make do with the 8 bits in the g buffer's alpha. Shaders compiled
+    // afterwards see PRECISE_DEPTH defined if it's in use.
+    RenderPipeline(bool preciseDepth = true, float renderScale = 1.0f);
     void ClearBuffers();
-    uint8_t getDepth(float x, float y);
-    Eigen::Vector3f getNormal(float x, float y, Eigen::Matrix4f mvp);
+    // Binds frameBuffer with the g buffer and depth attached, to draw into,
+    // and sets the viewport to their size
+    void BindGBuffer();
+    // Binds the light buffer, and sets the viewport to its size
+    void BindLightBuffer();
+
+    // Clamped to [RENDER_SCALE_MIN, 1]. Reallocates the buffers if their size
+    // changes, so shouldn't be called every frame.
+    void SetRenderScale(float scale);
+    float RenderScale() const { return renderScale; }
+    // Queues the composite of the light buffer. Lights call this as they're
+    // submitted, since a frame without any leaves nothing to composite.
+    void SubmitComposite();
+    void Execute(const DrawPacket & packet);
+
+    // Window-space depth at (x, y) in [0, 1] screen coordinates: 0 at the
+    // near plane, 1 at the far plane or where nothing has been drawn
+    float getDepth(float x, float y);
+    Eigen::Vector3f getNormal(float x, float y, const Eigen::Matrix4f & mvpInverse);
 
     GLuint frameBuffer;
 
     GLuint gBuffer; // R, G, B, Depth_MVP
-    GLuint depthBuffer;
+    GLuint depthBuffer; // Renderbuffer, without precise depth
+    GLuint depthTexture; // Otherwise, 0 if not in use
+
+    // Of the g buffer and the light buffer, in pixels
+    int width;
+    int height;
+
+private:
+    bool CreateDepthTexture();
+    // Half float if it can, otherwise 8 bits
+    void CreateLightBuffer();
+    // Sizes the g buffer, depth and light buffer to width and height
+    void AllocateBuffers();
+    // True if they're smaller than the display
+    bool Scaled() const;
+    // Window-space depths of a block of pixels, at most DEPTH_READ_SIZE on a
+    // side, row by row from the bottom left
+    void readDepths(int x, int y, int width, int height, float * depths);
+
+    // Depth textures can't be read back on GLES, so picking packs the pixels
+    // it wants into the RGBA of this small texture first
+    GLuint depthReadBuffer;
+    GLuint depthReadTexture;
+    GLuint depthPackShader;
+    GLint depthPackPosition;
+    GLint depthPackTexture;
+    GLint depthPackOffset;
+    GLint depthPackTexelSize;
+
+    GLuint squareVertices; // Covers the viewport, for the passes above and below
+
+    float renderScale;
+    bool compositeQueued; // This frame
+    GLuint lightFrameBuffer;
+    GLuint lightBuffer; // R, G, B
+    GLenum lightBufferFormat; // Internal format and type, for glTexImage2D
+    GLenum lightBufferType; // GL_UNSIGNED_BYTE if 8 bit
 
+    // composite_f.glsl, with and without UPSAMPLE defined
+    struct CompositeProgram {
+        void Create(bool upsample);
+        GLuint program;
+        GLint position;
+        GLint lightBuffer;
+        GLint gBuffer;
+        GLint depth;
+        GLint sourceSize;
+        GLint texelSize;
+        GLint depthParams;
+    };
+    CompositeProgram composite;
+    CompositeProgram upsample;
 };
 
 #endif // __nativeGraphics__RenderPipeline__
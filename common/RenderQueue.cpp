@@ -0,0 +1,72 @@
+// RenderQueue.cpp
+// nativeGraphics
+// Collects draws for a frame and issues them sorted by pass, shader and texture
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Profiler.h"
+#include "transform.h"
+#include "common.h"
+
+// Key layout, most significant first
+#define KEY_PASS_SHIFT 60 // 4 bits
+#define KEY_PROGRAM_SHIFT 48 // 12 bits
+#define KEY_TEXTURE_SHIFT 36 // 12 bits
+#define KEY_DEPTH_SHIFT 4 // 32 bits
+
+RenderQueue renderQueue;
+
+static bool KeyLess(const DrawPacket & a, const DrawPacket & b) {
+    return a.key < b.key;
+}
+
+uint64_t RenderQueue::Key(DrawPass pass, GLuint program, GLuint texture, float depth) {
+    uint64_t key = (uint64_t) pass << KEY_PASS_SHIFT;
+    if(pass == DRAW_PASS_OVERLAY)
+        return key;
+
+    // Names only need to group equal values, so wrapping around is harmless.
+    key |= (uint64_t) (program & 0xfff) << KEY_PROGRAM_SHIFT;
+    if(texture != (GLuint) -1)
+        key |= (uint64_t) (texture & 0xfff) << KEY_TEXTURE_SHIFT;
+
+    // Non-negative floats order the same as their bit patterns.
+    uint32_t depthBits = 0;
+    if(depth > 0.0f)
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+    key |= (uint64_t) depthBits << KEY_DEPTH_SHIFT;
+    return key;
+}
+
+DrawPacket & RenderQueue::Submit(Drawable * object, uint64_t key, int instance) {
+    packets.push_back(DrawPacket());
+    DrawPacket & packet = packets.back();
+    packet.key = key;
+    packet.object = object;
+    packet.instance = instance;
+    packet.instanceCount = 0;
+    memcpy(packet.modelView, transforms.mv().data(), sizeof(packet.modelView));
+    for(int i = 0; i < 4; i++)
+        packet.parameters[i] = 0.0f;
+    packet.texture = 0;
+    return packet;
+}
+
+void RenderQueue::Flush() {
+    PROFILE_ZONE("RenderQueue::Flush");
+
+    std::stable_sort(packets.begin(), packets.end(), KeyLess);
+
+    mvPushMatrix();
+    for(int i = 0; i < packets.size(); i++) {
+        model_view.load(Eigen::Map<const Matrix4f>(packets[i].modelView));
+        packets[i].object->Execute(packets[i]);
+    }
+    mvPopMatrix();
+
+    packets.clear();
+    flushes++;
+}
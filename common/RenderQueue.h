@@ -0,0 +1,73 @@
+// RenderQueue.h
+// nativeGraphics
+// Collects draws for a frame and issues them sorted by pass, shader and texture
+
+#ifndef __nativeGraphics__RenderQueue__
+#define __nativeGraphics__RenderQueue__
+
+#include <stdint.h>
+#include <vector>
+
+#include "graphics_header.h"
+
+struct DrawPacket;
+
+// Anything that can be queued: RenderObject, or a batch of work like the
+// tiled light pass
+class Drawable {
+public:
+    virtual ~Drawable() {}
+    // Makes a queued draw. The packet's transform is already loaded.
+    virtual void Execute(const DrawPacket & packet) = 0;
+};
+
+// In the order they're drawn
+enum DrawPass {
+    DRAW_PASS_GEOMETRY, // Into the g buffer, front to back
+    DRAW_PASS_LIGHTS, // Accumulated from the g buffer
+    DRAW_PASS_COMPOSITE, // Accumulated light to defaultFrameBuffer, if it went elsewhere
+    DRAW_PASS_OVERLAY // In submission order, for alpha blending
+};
+
+struct DrawPacket {
+    uint64_t key;
+    Drawable * object; // Must live until the queue is flushed
+    int instance;
+    int instanceCount; // If non-zero, draw this many instances from instance on
+    float modelView[16]; // Column-major, as on the stack at submission
+    float parameters[4]; // Interpreted by object->Execute (e.g. light color)
+    GLuint texture; // Ditto
+};
+
+// Objects submit packets instead of drawing, and Flush draws them ordered by
+// a 64-bit key: the pass, then the shader program, texture and view depth.
+// Within a key, packets keep the order they were submitted in.
+class RenderQueue {
+public:
+    RenderQueue() : flushes(0) {}
+
+    // Overlay packets ignore program, texture and depth, so they stay in
+    // submission order.
+    static uint64_t Key(DrawPass pass, GLuint program, GLuint texture = 0, float depth = 0.0f);
+
+    // Queues a draw of object with the current model-view matrix. The
+    // returned packet can be filled in further until the next Submit.
+    DrawPacket & Submit(Drawable * object, uint64_t key, int instance = 0);
+
+    // Draws everything queued, then empties the queue.
+    void Flush();
+
+    int Size() const { return packets.size(); }
+
+    // Changes with every Flush, so data referenced by packets can tell when
+    // it's no longer needed.
+    unsigned int Flushes() const { return flushes; }
+
+private:
+    std::vector<DrawPacket> packets; // Kept between frames, to reuse storage
+    unsigned int flushes;
+};
+
+extern RenderQueue renderQueue;
+
+#endif // __nativeGraphics__RenderQueue__
@@ -0,0 +1,199 @@
+// RenderState.cpp
+// nativeGraphics
+// Shadows GL binding and fixed-function state to filter redundant calls
+
+#include "RenderState.h"
+
+#include "log.h"
+
+#define UNKNOWN ((GLuint) -1) // No GL name or enum has this value
+
+RenderState renderState;
+
+static const GLenum trackedCapabilities[] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_DITHER, GL_SCISSOR_TEST };
+
+RenderState::RenderState() : issued(0), skipped(0) {
+    Invalidate();
+}
+
+void RenderState::Invalidate() {
+    program = UNKNOWN;
+    frameBuffer = UNKNOWN;
+    attachments.clear();
+    for(int i = 0; i < 4; i++)
+        viewport[i] = scissor[i] = -1;
+    for(int i = 0; i < RENDER_STATE_CAPABILITIES; i++)
+        capabilities[i] = -1;
+    depthMask = -1;
+    depthFunc = UNKNOWN;
+    blendFunc[0] = blendFunc[1] = UNKNOWN;
+    activeUnit = -1;
+    for(int i = 0; i < RENDER_STATE_TEXTURE_UNITS; i++)
+        textures[i] = UNKNOWN;
+    arrayBuffer = UNKNOWN;
+    elementArrayBuffer = UNKNOWN;
+}
+
+void RenderState::BeginFrame() {
+    Invalidate();
+    issued = 0;
+    skipped = 0;
+}
+
+template<typename T> bool RenderState::Redundant(T & current, T value) {
+    if(current == value) {
+        skipped++;
+        return true;
+    }
+    current = value;
+    issued++;
+    return false;
+}
+
+int RenderState::CapabilityIndex(GLenum capability) const {
+    for(int i = 0; i < RENDER_STATE_CAPABILITIES; i++) {
+        if(trackedCapabilities[i] == capability)
+            return i;
+    }
+    return -1;
+}
+
+void RenderState::UseProgram(GLuint program) {
+    if(Redundant(this->program, program))
+        return;
+    glUseProgram(program);
+    checkGlError("glUseProgram");
+}
+
+void RenderState::BindFramebuffer(GLuint frameBuffer) {
+    if(Redundant(this->frameBuffer, frameBuffer))
+        return;
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+}
+
+void RenderState::FramebufferTexture(GLenum attachment, GLuint texture) {
+    Attachments * current = BoundAttachments();
+    if(current && attachment == GL_COLOR_ATTACHMENT0) {
+        if(Redundant(current->color, texture))
+            return;
+    } else if(current && attachment == GL_DEPTH_ATTACHMENT) {
+        if(Redundant(current->depthTexture, texture))
+            return;
+        current->depth = UNKNOWN; // Replaces any renderbuffer
+    } else
+        issued++;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+}
+
+void RenderState::FramebufferRenderbuffer(GLenum attachment, GLuint renderBuffer) {
+    Attachments * current = BoundAttachments();
+    if(current && attachment == GL_DEPTH_ATTACHMENT) {
+        if(Redundant(current->depth, renderBuffer))
+            return;
+        current->depthTexture = UNKNOWN; // Replaces any texture
+    } else
+        issued++;
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, renderBuffer);
+}
+
+RenderState::Attachments * RenderState::BoundAttachments() {
+    if(frameBuffer == UNKNOWN)
+        return NULL;
+    std::map<GLuint, Attachments>::iterator i = attachments.find(frameBuffer);
+    if(i == attachments.end()) {
+        Attachments unknown = { UNKNOWN, UNKNOWN, UNKNOWN };
+        i = attachments.insert(std::make_pair(frameBuffer, unknown)).first;
+    }
+    return &i->second;
+}
+
+void RenderState::Viewport(int x, int y, int width, int height) {
+    if(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height) {
+        skipped++;
+        return;
+    }
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = width;
+    viewport[3] = height;
+    issued++;
+    glViewport(x, y, width, height);
+}
+
+void RenderState::Scissor(int x, int y, int width, int height) {
+    if(scissor[0] == x && scissor[1] == y && scissor[2] == width && scissor[3] == height) {
+        skipped++;
+        return;
+    }
+    scissor[0] = x;
+    scissor[1] = y;
+    scissor[2] = width;
+    scissor[3] = height;
+    issued++;
+    glScissor(x, y, width, height);
+}
+
+void RenderState::Enable(GLenum capability, bool enabled) {
+    int index = CapabilityIndex(capability);
+    if(index < 0)
+        issued++;
+    else if(Redundant(capabilities[index], (int) enabled))
+        return;
+    if(enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void RenderState::DepthMask(GLboolean mask) {
+    if(Redundant(depthMask, (GLint) mask))
+        return;
+    glDepthMask(mask);
+}
+
+void RenderState::DepthFunc(GLenum func) {
+    if(Redundant(depthFunc, func))
+        return;
+    glDepthFunc(func);
+}
+
+void RenderState::BlendFunc(GLenum source, GLenum destination) {
+    if(blendFunc[0] == source && blendFunc[1] == destination) {
+        skipped++;
+        return;
+    }
+    blendFunc[0] = source;
+    blendFunc[1] = destination;
+    issued++;
+    glBlendFunc(source, destination);
+}
+
+void RenderState::BindTexture(int unit, GLuint texture) {
+    if(unit < 0 || unit >= RENDER_STATE_TEXTURE_UNITS) {
+        LOGE("RenderState::BindTexture: Unit %d not tracked.", unit);
+        return;
+    }
+    // Even when the texture is already bound, callers may go on to upload
+    // to it, so the unit has to be the active one
+    if(!Redundant(activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    if(textures[unit] == texture) {
+        skipped++;
+        return;
+    }
+    textures[unit] = texture;
+    issued++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RenderState::BindBuffer(GLenum target, GLuint buffer) {
+    if(target == GL_ARRAY_BUFFER) {
+        if(Redundant(arrayBuffer, buffer))
+            return;
+    } else if(target == GL_ELEMENT_ARRAY_BUFFER) {
+        if(Redundant(elementArrayBuffer, buffer))
+            return;
+    } else
+        issued++;
+    glBindBuffer(target, buffer);
+}
@@ -0,0 +1,86 @@
+// RenderState.h
+// nativeGraphics
+// Shadows GL binding and fixed-function state to filter redundant calls
+
+#ifndef __nativeGraphics__RenderState__
+#define __nativeGraphics__RenderState__
+
+#include <map>
+
+#include "graphics_header.h"
+
+#define RENDER_STATE_TEXTURE_UNITS 8
+#define RENDER_STATE_CAPABILITIES 5
+
+// Each setter only reaches GL if the value differs from what was last set
+// through it. Code that changes the same state behind its back must call
+// Invalidate afterwards. Since the platform layer may touch anything between
+// frames, BeginFrame forgets everything.
+class RenderState {
+public:
+    RenderState();
+
+    void Invalidate();
+    void BeginFrame(); // Invalidates, and starts counting calls afresh
+
+    void UseProgram(GLuint program);
+    void BindFramebuffer(GLuint frameBuffer);
+    // Attach to whichever framebuffer is bound
+    void FramebufferTexture(GLenum attachment, GLuint texture);
+    void FramebufferRenderbuffer(GLenum attachment, GLuint renderBuffer);
+    void Viewport(int x, int y, int width, int height);
+    void Scissor(int x, int y, int width, int height);
+
+    // Tracked for GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_DITHER and
+    // GL_SCISSOR_TEST.
+    // Anything else always goes through.
+    void Enable(GLenum capability, bool enabled);
+    void DepthMask(GLboolean mask);
+    void DepthFunc(GLenum func);
+    void BlendFunc(GLenum source, GLenum destination);
+
+    // GL_TEXTURE_2D on the given unit, which is left active even if the
+    // texture was already bound, so it can be uploaded to straight after
+    void BindTexture(int unit, GLuint texture);
+    // GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+    void BindBuffer(GLenum target, GLuint buffer);
+
+    // Calls made through the setters since BeginFrame
+    int Issued() const { return issued; }
+    int Skipped() const { return skipped; }
+
+private:
+    // True, counting the call as skipped, if current already equals value.
+    // Otherwise records value and counts the call as issued.
+    template<typename T> bool Redundant(T & current, T value);
+    int CapabilityIndex(GLenum capability) const;
+
+    struct Attachments {
+        GLuint color; // GL_COLOR_ATTACHMENT0 texture
+        GLuint depth; // GL_DEPTH_ATTACHMENT renderbuffer
+        GLuint depthTexture; // GL_DEPTH_ATTACHMENT texture
+    };
+    // What's attached to the bound framebuffer, or NULL if that's unknown
+    Attachments * BoundAttachments();
+
+    GLuint program;
+    GLuint frameBuffer;
+    std::map<GLuint, Attachments> attachments;
+    int viewport[4];
+    int scissor[4];
+    int capabilities[RENDER_STATE_CAPABILITIES]; // 0, 1, or -1 if unknown
+    GLint depthMask;
+    GLenum depthFunc;
+    GLenum blendFunc[2];
+    int activeUnit;
+    GLuint textures[RENDER_STATE_TEXTURE_UNITS];
+    GLuint arrayBuffer;
+    GLuint elementArrayBuffer;
+
+    int issued;
+    int skipped;
+};
+
+extern RenderState renderState;
+
+#endif // __nativeGraphics__RenderState__
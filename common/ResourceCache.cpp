@@ -0,0 +1,160 @@
+// ResourceCache.cpp
+// nativeGraphics
+// On-disk cache of parsed meshes and decoded textures, keyed by source file
+
+#include "ResourceCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "mesh_format.h"
+#include "log.h"
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void * data, size_t size) {
+    const unsigned char * bytes = (const unsigned char *) data;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+ResourceCache::ResourceCache(const char * directory, bool (*statfunc)(const char *, long *, long *))
+    : directory(directory), statfunc(statfunc), hits(0), misses(0) {
+    if(!this->directory.empty() && this->directory[this->directory.size() - 1] != '/')
+        this->directory += '/';
+    mkdir(this->directory.c_str(), 0755); // Fine if it already exists
+}
+
+// Empty if the resource can't be found.
+std::string ResourceCache::EntryPath(const char * fileName, const char * kind) {
+    long size, mtime;
+    if(!statfunc(fileName, &size, &mtime))
+        return std::string();
+
+    int version = RESOURCE_CACHE_VERSION;
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hashBytes(hash, fileName, strlen(fileName) + 1);
+    hash = hashBytes(hash, &size, sizeof(size));
+    hash = hashBytes(hash, &mtime, sizeof(mtime));
+    hash = hashBytes(hash, &version, sizeof(version));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.%s", (unsigned long long) hash, kind);
+    return directory + name;
+}
+
+void * ResourceCache::Load(const std::string & path, int & size) {
+    FILE * file = path.empty() ? NULL : fopen(path.c_str(), "rb");
+    if(!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void * data = malloc(size);
+    if(data && fread(data, 1, size, file) != (size_t) size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+// Records whether a lookup found a usable entry.
+void * ResourceCache::Count(void * entry) {
+    __sync_fetch_and_add(entry ? &hits : &misses, 1);
+    return entry;
+}
+
+// Moves a finished entry into place, so readers never see a partial file.
+bool ResourceCache::Commit(const std::string & tempPath, const std::string & path) {
+    if(rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOGE("Unable to write cache entry %s", path.c_str());
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+static std::string tempPathFor(const std::string & path) {
+    static volatile int counter = 0;
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d.%d.tmp", (int) getpid(), __sync_fetch_and_add(&counter, 1));
+    return path + suffix;
+}
+
+void * ResourceCache::LoadMesh(const char * fileName, const float *& vertexBuffer, int & numVertices, const void *& indices, int & numIndices, int & indexSize) {
+    int size = 0;
+    int floatsPerVertex = 0;
+    void * data = Load(EntryPath(fileName, "mesh"), size);
+    vertexBuffer = readMeshFile(data, size, numVertices, floatsPerVertex, indices, numIndices, indexSize);
+    if(data != NULL && (vertexBuffer == NULL || floatsPerVertex != 3+3+2)) {
+        LOGE("Ignoring stale cache entry for %s", fileName);
+        free(data);
+        data = NULL;
+    }
+    return Count(data);
+}
+
+void ResourceCache::StoreMesh(const char * fileName, const float * vertexBuffer, int numVertices, const unsigned int * indices, int numIndices) {
+    std::string path = EntryPath(fileName, "mesh");
+    if(path.empty())
+        return;
+    std::string tempPath = tempPathFor(path);
+    if(writeMeshFile(tempPath.c_str(), vertexBuffer, numVertices, 3+3+2, indices, numIndices))
+        Commit(tempPath, path);
+    else
+        remove(tempPath.c_str());
+}
+
+void * ResourceCache::LoadTexture(const char * fileName, const void *& pixels, int & width, int & height) {
+    int size = 0;
+    void * data = Load(EntryPath(fileName, "tex"), size);
+    if(data == NULL)
+        return Count(NULL);
+
+    const struct TextureCacheHeader * header = (const struct TextureCacheHeader *) data;
+    if(size < (int) sizeof(*header) || memcmp(header->magic, TEXTURE_CACHE_MAGIC, 4) != 0
+       || size != (int) sizeof(*header) + (int) (header->width * header->height * 4)) {
+        LOGE("Ignoring corrupt cache entry for %s", fileName);
+        free(data);
+        return Count(NULL);
+    }
+    width = header->width;
+    height = header->height;
+    pixels = header + 1;
+    return Count(data);
+}
+
+void ResourceCache::StoreTexture(const char * fileName, const void * pixels, int width, int height) {
+    std::string path = EntryPath(fileName, "tex");
+    if(path.empty() || pixels == NULL)
+        return;
+    std::string tempPath = tempPathFor(path);
+    FILE * file = fopen(tempPath.c_str(), "wb");
+    if(!file) {
+        LOGE("Unable to open %s for writing", tempPath.c_str());
+        return;
+    }
+
+    struct TextureCacheHeader header;
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+    header.width = width;
+    header.height = height;
+    size_t numBytes = (size_t) width * height * 4;
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1
+                && fwrite(pixels, 1, numBytes, file) == numBytes;
+    if(fclose(file) != 0)
+        success = false;
+
+    if(success)
+        Commit(tempPath, path);
+    else
+        remove(tempPath.c_str());
+}
@@ -0,0 +1,57 @@
+// ResourceCache.h
+// nativeGraphics
+// On-disk cache of parsed meshes and decoded textures, keyed by source file
+
+#ifndef __nativeGraphics__ResourceCache__
+#define __nativeGraphics__ResourceCache__
+
+#include <stdint.h>
+#include <string>
+
+// Bump when getIndexedBuffer or the texture layout changes, so stale entries
+// stop matching.
+#define RESOURCE_CACHE_VERSION 1
+
+#define TEXTURE_CACHE_MAGIC "NGTX"
+
+// A cached texture is this header followed by width * height RGBA pixels.
+struct TextureCacheHeader {
+    char magic[4];
+    uint32_t width;
+    uint32_t height;
+};
+
+// Entries are named by a hash of the resource name, its size and
+// modification time, so an edited source simply misses and is reprocessed.
+// Safe to use from several threads at once.
+class ResourceCache {
+public:
+    // statfunc reports a resource's size and modification time, returning
+    // false if it doesn't exist.
+    ResourceCache(const char * directory, bool (*statfunc)(const char *, long *, long *));
+
+    // On a hit, returns the malloc'd cache entry and points the outputs into
+    // it, to be freed once uploaded. Returns NULL on a miss.
+    void * LoadMesh(const char * fileName, const float *& vertexBuffer, int & numVertices, const void *& indices, int & numIndices, int & indexSize);
+    void * LoadTexture(const char * fileName, const void *& pixels, int & width, int & height);
+
+    // Record a freshly processed resource; failures are logged and ignored.
+    void StoreMesh(const char * fileName, const float * vertexBuffer, int numVertices, const unsigned int * indices, int numIndices);
+    void StoreTexture(const char * fileName, const void * pixels, int width, int height);
+
+    int Hits() const { return hits; }
+    int Misses() const { return misses; }
+
+private:
+    std::string EntryPath(const char * fileName, const char * kind);
+    void * Load(const std::string & path, int & size);
+    void * Count(void * entry);
+    bool Commit(const std::string & tempPath, const std::string & path);
+
+    std::string directory;
+    bool (*statfunc)(const char *, long *, long *);
+    volatile int hits;
+    volatile int misses;
+};
+
+#endif // __nativeGraphics__ResourceCache__
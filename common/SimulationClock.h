@@ -0,0 +1,76 @@
+// SimulationClock.h
+// nativeGraphics
+// Fixed timestep clock driving all game simulation
+
+#ifndef __nativeGraphics__SimulationClock__
+#define __nativeGraphics__SimulationClock__
+
+#include "Timer.h"
+
+#define SIMULATION_STEP (1.0f / 60.0f)
+#define SIMULATION_MAX_STEPS 5 // Per frame, so a slow frame can't snowball
+
+// Real time is accumulated once per frame and consumed in fixed steps, so the
+// simulation gives the same results at any frame rate. Rendering
+// interpolates between the last two steps using Alpha().
+//
+//     simClock.Advance();
+//     while(simClock.Step())
+//         Simulate(simClock.Dt());
+//     Render(simClock.Alpha());
+class SimulationClock {
+public:
+    SimulationClock(float step = SIMULATION_STEP, int maxSteps = SIMULATION_MAX_STEPS)
+        : step(step), maxSteps(maxSteps), fixedFrameTime(0.0f) {
+        Reset();
+    }
+
+    void Reset() {
+        last = monotonicSeconds();
+        accumulator = 0.0;
+        time = 0.0;
+    }
+
+    // Adds the time since the previous frame. Call once per frame.
+    void Advance() {
+        double now = monotonicSeconds();
+        accumulator += fixedFrameTime > 0.0f ? fixedFrameTime : now - last;
+        last = now;
+        if(accumulator > maxSteps * step)
+            accumulator = maxSteps * step;
+    }
+
+    // Consumes one step, returning false once less than a step remains.
+    bool Step() {
+        if(accumulator < step)
+            return false;
+        accumulator -= step;
+        time += step;
+        return true;
+    }
+
+    float Dt() const { return step; }
+
+    // Simulated seconds, advanced only by Step.
+    double Time() const { return time; }
+
+    // How far rendering is between the last step and the next, in [0, 1).
+    float Alpha() const { return accumulator / step; }
+
+    // Smooth time for animation, e.g. shader uniforms.
+    double RenderTime() const { return time + accumulator; }
+
+    // Pretend every frame took this long (0 to use real time), for
+    // reproducible benchmark runs.
+    void SetFixedFrameTime(float seconds) { fixedFrameTime = seconds; }
+
+private:
+    float step;
+    int maxSteps;
+    float fixedFrameTime;
+    double last;
+    double accumulator;
+    double time;
+};
+
+#endif // __nativeGraphics__SimulationClock__
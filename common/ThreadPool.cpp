@@ -0,0 +1,130 @@
+// ThreadPool.cpp
+// nativeGraphics
+// Fixed set of worker threads for splitting CPU work across cores
+
+#include "ThreadPool.h"
+
+#include <unistd.h>
+
+#include "log.h"
+
+ThreadPool::ThreadPool(int numThreads) {
+    if(numThreads <= 0) {
+        numThreads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+        if(numThreads < 1)
+            numThreads = 1;
+    }
+
+    stopping = false;
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&taskAdded, NULL);
+    pthread_cond_init(&taskFinished, NULL);
+
+    for(int i = 0; i < numThreads; i++) {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, WorkerMain, this) != 0) {
+            LOGE("ThreadPool: Unable to start worker thread.");
+            break;
+        }
+        threads.push_back(thread);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&taskAdded);
+    pthread_mutex_unlock(&mutex);
+
+    for(int i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_cond_destroy(&taskFinished);
+    pthread_cond_destroy(&taskAdded);
+    pthread_mutex_destroy(&mutex);
+}
+
+static ThreadPool * sharedPool = NULL;
+static pthread_once_t sharedPoolOnce = PTHREAD_ONCE_INIT;
+
+static void CreateSharedPool() {
+    sharedPool = new ThreadPool();
+}
+
+ThreadPool * ThreadPool::Shared() {
+    pthread_once(&sharedPoolOnce, CreateSharedPool);
+    return sharedPool;
+}
+
+void ThreadPool::RunTask(const Task & task) {
+    pthread_mutex_unlock(&mutex);
+    task.function(task.arg);
+    pthread_mutex_lock(&mutex);
+
+    if(task.batch && --task.batch->remaining == 0)
+        pthread_cond_broadcast(&taskFinished);
+}
+
+void * ThreadPool::WorkerMain(void * arg) {
+    ThreadPool * pool = (ThreadPool *) arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    while(true) {
+        while(pool->tasks.empty() && !pool->stopping)
+            pthread_cond_wait(&pool->taskAdded, &pool->mutex);
+        if(pool->tasks.empty())
+            break; // Stopping, and nothing left to do
+
+        Task task = pool->tasks.front();
+        pool->tasks.pop_front();
+        pool->RunTask(task);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+void ThreadPool::Run(void (*function)(void *), void ** args, int numTasks) {
+    if(numTasks <= 0)
+        return;
+
+    Batch batch;
+    batch.remaining = numTasks;
+
+    pthread_mutex_lock(&mutex);
+    for(int i = 0; i < numTasks; i++) {
+        Task task;
+        task.function = function;
+        task.arg = args[i];
+        task.batch = &batch;
+        tasks.push_back(task);
+    }
+    pthread_cond_broadcast(&taskAdded);
+
+    // Help out rather than sleep while any of this batch is queued. Other
+    // tasks are left to the workers, as they may take arbitrarily long.
+    while(batch.remaining > 0) {
+        std::deque<Task>::iterator it = tasks.begin();
+        while(it != tasks.end() && it->batch != &batch)
+            ++it;
+        if(it != tasks.end()) {
+            Task task = *it;
+            tasks.erase(it);
+            RunTask(task);
+        } else {
+            pthread_cond_wait(&taskFinished, &mutex);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void ThreadPool::Submit(void (*function)(void *), void * arg) {
+    Task task;
+    task.function = function;
+    task.arg = arg;
+    task.batch = NULL;
+
+    pthread_mutex_lock(&mutex);
+    tasks.push_back(task);
+    pthread_cond_signal(&taskAdded);
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,54 @@
+// ThreadPool.h
+// nativeGraphics
+// Fixed set of worker threads for splitting CPU work across cores
+
+#ifndef __nativeGraphics__ThreadPool__
+#define __nativeGraphics__ThreadPool__
+
+#include <pthread.h>
+
+#include <deque>
+#include <vector>
+
+class ThreadPool {
+public:
+    // numThreads = 0 starts one worker per core, less one for the caller.
+    ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    // Runs task(args[i]) for every i and returns once all have finished.
+    // The calling thread works through the batch's queued tasks while it
+    // waits, so Run may safely be nested inside another task on the pool.
+    void Run(void (*task)(void *), void ** args, int numTasks);
+
+    // Queues task(arg) to run on a worker and returns immediately.
+    void Submit(void (*task)(void *), void * arg);
+
+    int NumThreads() const { return threads.size(); }
+
+    // Pool shared by the whole program, created on first use.
+    static ThreadPool * Shared();
+
+private:
+    struct Batch {
+        int remaining;
+    };
+
+    struct Task {
+        void (*function)(void *);
+        void * arg;
+        Batch * batch; // NULL for submitted tasks
+    };
+
+    static void * WorkerMain(void * pool);
+    void RunTask(const Task & task); // Called with mutex held
+
+    std::vector<pthread_t> threads;
+    std::deque<Task> tasks;
+    pthread_mutex_t mutex;
+    pthread_cond_t taskAdded;
+    pthread_cond_t taskFinished;
+    bool stopping;
+};
+
+#endif // __nativeGraphics__ThreadPool__
@@ -0,0 +1,246 @@
+// TiledLighting.cpp
+// nativeGraphics
+// Shades the frame's lights together over screen tiles, instead of one light volume draw each
+
+#include "TiledLighting.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "common.h"
+#include "Frustum.h"
+#include "glsl_helper.h"
+#include "log.h"
+#include "Profiler.h"
+#include "RenderPipeline.h"
+#include "RenderState.h"
+#include "UniformBuffers.h"
+#include "transform.h"
+
+// Four per light, plus the inverse projection and a little to spare
+#define TILED_LIGHTS_UNIFORM_VECTORS (4 * TILED_LIGHTS_PER_PASS + 16)
+
+TiledLighting tiledLighting;
+
+TiledLighting::TiledLighting() : enabled(false), program(0), vertexBuffer(0) {
+}
+
+void TiledLighting::Init(bool allow) {
+    enabled = false;
+    if(!allow)
+        return;
+
+    GLint uniformVectors = 0;
+    glGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_VECTORS, &uniformVectors);
+    if(glGetError() != GL_NO_ERROR)
+        uniformVectors = TILED_LIGHTS_UNIFORM_VECTORS; // GL before 4.1 doesn't know it, but has plenty
+    if(uniformVectors < TILED_LIGHTS_UNIFORM_VECTORS) {
+        LOGI("Only %d fragment uniform vectors, drawing light volumes instead of tiles", uniformVectors);
+        return;
+    }
+
+    program = createShaderProgram((char *)loadResource("dr_square_v.glsl"), (char *)loadResource("tiled_lights_f.glsl"));
+    const ShaderLocations & locations = shaderLocations(program);
+    positionHandle = locations.Attribute("a_Position");
+    fragWidthUniform = locations.Uniform("u_FragWidth");
+    fragHeightUniform = locations.Uniform("u_FragHeight");
+    pInverseUniform = locations.Uniform("u_pT_Matrix");
+    gBufferUniform = locations.Uniform("u_gBuffer");
+    gDepthUniform = locations.Uniform("u_gDepth");
+    numLightsUniform = locations.Uniform("u_NumLights");
+    lightPositionUniform = locations.Uniform("u_LightPosition");
+    lightColorUniform = locations.Uniform("u_LightColor");
+    lightDirectionUniform = locations.Uniform("u_LightDirection");
+    lightVolumeUniform = locations.Uniform("u_LightVolume");
+
+    glGenBuffers(1, &vertexBuffer);
+    checkGlError("TiledLighting::Init");
+    enabled = true;
+    LOGI("Shading lights in %d pixel tiles", TILED_LIGHTS_TILE_SIZE);
+}
+
+bool TiledLighting::Add(TiledLightFalloff falloff, TiledLightVolume volume, const float size[2],
+                        const float color[3], float brightness, float reach) {
+    int numLights = positions.size() / 4;
+    if(numLights >= TILED_LIGHTS_MAX)
+        return false;
+    if(numLights == 0)
+        renderQueue.Submit(this, RenderQueue::Key(DRAW_PASS_LIGHTS, program));
+
+    const Matrix4f & mv = transforms.mv();
+    Eigen::Vector3f position = mv.col(3).head<3>();
+    Eigen::Vector3f yAxis = mv.col(1).head<3>();
+    float yScale = yAxis.norm();
+    float scale = mv.block<3, 3>(0, 0).colwise().norm().maxCoeff();
+    Eigen::Vector3f direction = yAxis / yScale;
+
+    for(int i = 0; i < 3; i++) {
+        positions.push_back(position[i]);
+        colors.push_back(color[i]);
+        directions.push_back(direction[i]);
+    }
+    positions.push_back(falloff);
+    colors.push_back(brightness);
+    directions.push_back(0.0f);
+
+    // The shader tests against the volume, bounds only has to enclose it
+    Eigen::Vector3f center = position;
+    float radius = -1.0f;
+    volumes.push_back(volume);
+    if(volume == TILED_VOLUME_SPHERE) {
+        radius = scale * size[0];
+        volumes.push_back(radius);
+        volumes.push_back(0.0f);
+    } else if(volume == TILED_VOLUME_CONE) {
+        float length = yScale * size[0];
+        float slope = size[1] / size[0];
+        volumes.push_back(length);
+        volumes.push_back(slope);
+        center = position - .5f * length * direction;
+        radius = length * sqrtf(.25f + slope * slope);
+    } else {
+        volumes.push_back(0.0f);
+        volumes.push_back(0.0f);
+    }
+    volumes.push_back(reach);
+
+    // Bin by whichever of the volume and the falloff's reach is tighter
+    if(radius < 0.0f || reach < radius) {
+        center = position;
+        radius = reach;
+    }
+    for(int i = 0; i < 3; i++)
+        bounds.push_back(center[i]);
+    bounds.push_back(radius);
+    return true;
+}
+
+void TiledLighting::Bounds(int light, int tileBounds[4]) const {
+    int tilesX = (pipeline->width + TILED_LIGHTS_TILE_SIZE - 1) / TILED_LIGHTS_TILE_SIZE;
+    int tilesY = (pipeline->height + TILED_LIGHTS_TILE_SIZE - 1) / TILED_LIGHTS_TILE_SIZE;
+    tileBounds[0] = tileBounds[1] = 0;
+    tileBounds[2] = tilesX - 1;
+    tileBounds[3] = tilesY - 1;
+
+    const float * sphere = &bounds[light * 4];
+    float rect[4];
+    if(!screenRect(transforms.p(), Vector3f(sphere[0], sphere[1], sphere[2]), sphere[3], rect))
+        return;
+
+    int size[2] = { pipeline->width, pipeline->height };
+    for(int i = 0; i < 2; i++) {
+        int first = (int) floorf((.5f * rect[i] + .5f) * size[i] / TILED_LIGHTS_TILE_SIZE);
+        int last = (int) floorf((.5f * rect[i + 2] + .5f) * size[i] / TILED_LIGHTS_TILE_SIZE);
+        tileBounds[i] = std::max(tileBounds[i], first);
+        tileBounds[i + 2] = std::min(tileBounds[i + 2], last); // Below first if it's off screen
+    }
+}
+
+void TiledLighting::Execute(const DrawPacket & packet) {
+    PROFILE_ZONE("TiledLighting::Execute");
+
+    int numLights = positions.size() / 4;
+    int tilesX = (pipeline->width + TILED_LIGHTS_TILE_SIZE - 1) / TILED_LIGHTS_TILE_SIZE;
+    int tilesY = (pipeline->height + TILED_LIGHTS_TILE_SIZE - 1) / TILED_LIGHTS_TILE_SIZE;
+
+    // Bin the lights
+    tileLights.assign(tilesX * tilesY, 0);
+    for(int light = 0; light < numLights; light++) {
+        int tileBounds[4];
+        Bounds(light, tileBounds);
+        for(int y = tileBounds[1]; y <= tileBounds[3]; y++) {
+            for(int x = tileBounds[0]; x <= tileBounds[2]; x++)
+                tileLights[y * tilesX + x] |= (uint64_t) 1 << light;
+        }
+    }
+
+    // Group tiles lit by the same lights, and lay out two triangles per tile
+    // with each group's together
+    tilesByLights.clear();
+    for(int tile = 0; tile < tilesX * tilesY; tile++) {
+        if(tileLights[tile])
+            tilesByLights[tileLights[tile]].push_back(tile);
+    }
+    vertices.clear();
+    std::map<uint64_t, std::vector<int> >::const_iterator group;
+    for(group = tilesByLights.begin(); group != tilesByLights.end(); group++) {
+        for(int i = 0; i < group->second.size(); i++) {
+            int tile = group->second[i];
+            float x0 = 2.0f * (tile % tilesX) * TILED_LIGHTS_TILE_SIZE / pipeline->width - 1.0f;
+            float y0 = 2.0f * (tile / tilesX) * TILED_LIGHTS_TILE_SIZE / pipeline->height - 1.0f;
+            float x1 = std::min(1.0f, x0 + 2.0f * TILED_LIGHTS_TILE_SIZE / pipeline->width);
+            float y1 = std::min(1.0f, y0 + 2.0f * TILED_LIGHTS_TILE_SIZE / pipeline->height);
+            const GLfloat corners[] = { x0, y0, x1, y0, x1, y1, x0, y0, x1, y1, x0, y1 };
+            vertices.insert(vertices.end(), corners, corners + 12);
+        }
+    }
+
+    renderState.UseProgram(program);
+    pipeline->BindLightBuffer();
+
+    renderState.Enable(GL_CULL_FACE, false);
+    renderState.Enable(GL_DEPTH_TEST, false);
+    renderState.Enable(GL_BLEND, true);
+    renderState.BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    renderState.Enable(GL_DITHER, true);
+
+    if(uniformBuffers.IsEnabled()) {
+        // Fragment size and the inverse projection come with the frame block
+        uniformBuffers.SetObject();
+    } else {
+        glUniform1i(fragWidthUniform, pipeline->width);
+        glUniform1i(fragHeightUniform, pipeline->height);
+        glUniformMatrix4fv(pInverseUniform, 1, GL_FALSE, pInverseMatrix());
+    }
+
+    renderState.BindTexture(0, pipeline->gBuffer);
+    glUniform1i(gBufferUniform, 0);
+    if(pipeline->depthTexture) {
+        renderState.BindTexture(1, pipeline->depthTexture);
+        glUniform1i(gDepthUniform, 1);
+    }
+
+    renderState.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.empty() ? NULL : &vertices[0], GL_STREAM_DRAW);
+    glEnableVertexAttribArray(positionHandle);
+    glVertexAttribPointer(positionHandle, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid*) 0);
+    checkGlError("TiledLighting vertices");
+
+    int firstVertex = 0;
+    for(group = tilesByLights.begin(); group != tilesByLights.end(); group++) {
+        int numVertices = group->second.size() * 6;
+
+        int lights[TILED_LIGHTS_MAX];
+        int count = 0;
+        for(int light = 0; light < numLights; light++) {
+            if(group->first & ((uint64_t) 1 << light))
+                lights[count++] = light;
+        }
+
+        for(int batch = 0; batch < count; batch += TILED_LIGHTS_PER_PASS) {
+            int batchSize = std::min(count - batch, TILED_LIGHTS_PER_PASS);
+            GLfloat uniforms[4][TILED_LIGHTS_PER_PASS * 4];
+            for(int i = 0; i < batchSize; i++) {
+                int light = lights[batch + i];
+                std::copy(&positions[light * 4], &positions[light * 4] + 4, &uniforms[0][i * 4]);
+                std::copy(&colors[light * 4], &colors[light * 4] + 4, &uniforms[1][i * 4]);
+                std::copy(&directions[light * 4], &directions[light * 4] + 4, &uniforms[2][i * 4]);
+                std::copy(&volumes[light * 4], &volumes[light * 4] + 4, &uniforms[3][i * 4]);
+            }
+            glUniform1i(numLightsUniform, batchSize);
+            glUniform4fv(lightPositionUniform, batchSize, uniforms[0]);
+            glUniform4fv(lightColorUniform, batchSize, uniforms[1]);
+            glUniform4fv(lightDirectionUniform, batchSize, uniforms[2]);
+            glUniform4fv(lightVolumeUniform, batchSize, uniforms[3]);
+            glDrawArrays(GL_TRIANGLES, firstVertex, numVertices);
+        }
+        firstVertex += numVertices;
+    }
+    checkGlError("TiledLighting::Execute");
+
+    positions.clear();
+    colors.clear();
+    directions.clear();
+    volumes.clear();
+    bounds.clear();
+}
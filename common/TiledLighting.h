@@ -0,0 +1,97 @@
+// TiledLighting.h
+// nativeGraphics
+// Shades the frame's lights together over screen tiles, instead of one light volume draw each
+
+#ifndef __nativeGraphics__TiledLighting__
+#define __nativeGraphics__TiledLighting__
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include "graphics_header.h"
+#include "RenderQueue.h"
+
+// Tiles are this many pixels on a side
+#define TILED_LIGHTS_TILE_SIZE 64
+// Lights per draw, as declared in tiled_lights_f.glsl. A tile lit by more
+// is drawn again for each further batch, blended on top.
+#define TILED_LIGHTS_PER_PASS 8
+// Lights per frame, so a tile's lights fit a bit mask. Any more are drawn
+// with their volumes.
+#define TILED_LIGHTS_MAX 64
+
+// Falloffs, each matching one of the light volume shaders
+enum TiledLightFalloff {
+    TILED_LIGHT_POINT, // dr_pointlight_f.glsl
+    TILED_LIGHT_SATURATING, // dr_pointlight_sat_f.glsl
+    TILED_LIGHT_EXPLOSIVE, // dr_explosive_pointlight_f.glsl
+    TILED_LIGHT_SPOT // dr_spotlight_f.glsl
+};
+
+// What a light is clipped to, in its model space
+enum TiledLightVolume {
+    TILED_VOLUME_NONE, // Lights the whole screen
+    TILED_VOLUME_SPHERE, // Of the given radius about the light
+    TILED_VOLUME_CONE // Apex at the light, opening along -y
+};
+
+// Lights submitted through Add go in a list for the frame. The first one
+// queues this in the lights pass, and when that's drawn every light is
+// binned into the tiles its volume covers on screen. Tiles lit by the same
+// lights are then drawn together, reading the g buffer once per pixel for
+// up to TILED_LIGHTS_PER_PASS lights.
+class TiledLighting : public Drawable {
+public:
+    TiledLighting();
+
+    // Must be called on the GL thread after the pipeline is created, since
+    // the shader depends on its layout. Stays off if allow is false.
+    void Init(bool allow);
+    bool IsEnabled() const { return enabled; }
+
+    // Adds a light at the current model-view transform. size is the
+    // sphere's radius, or the cone's length and then base radius, in model
+    // space. reach is the view-space distance past which the falloff adds
+    // nothing. False if the list is full, and the light should be drawn on
+    // its own instead.
+    bool Add(TiledLightFalloff falloff, TiledLightVolume volume, const float size[2],
+             const float color[3], float brightness, float reach);
+
+    void Execute(const DrawPacket & packet);
+
+private:
+    // Screen rectangle, in tiles, that a light can reach
+    void Bounds(int light, int tileBounds[4]) const;
+
+    bool enabled;
+    GLuint program;
+    GLuint vertexBuffer;
+    GLint positionHandle;
+    GLint fragWidthUniform;
+    GLint fragHeightUniform;
+    GLint pInverseUniform;
+    GLint gBufferUniform;
+    GLint gDepthUniform;
+    GLint numLightsUniform;
+    GLint lightPositionUniform;
+    GLint lightColorUniform;
+    GLint lightDirectionUniform;
+    GLint lightVolumeUniform;
+
+    // This frame's lights, four floats each, as the uniforms take them
+    std::vector<float> positions;
+    std::vector<float> colors;
+    std::vector<float> directions;
+    std::vector<float> volumes;
+    std::vector<float> bounds; // View-space bounding sphere: center, then radius
+
+    // Kept between frames, to reuse storage
+    std::vector<uint64_t> tileLights;
+    std::map<uint64_t, std::vector<int> > tilesByLights;
+    std::vector<GLfloat> vertices;
+};
+
+extern TiledLighting tiledLighting;
+
+#endif // __nativeGraphics__TiledLighting__
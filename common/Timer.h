@@ -4,8 +4,25 @@
 #ifndef TIMER_H
 #define TIMER_H
 
-//#include <cstdlib>
-#include <sys/time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+// Seconds from an arbitrary fixed point, unaffected by wall clock changes.
+static inline double monotonicSeconds() {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if(timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double) mach_absolute_time() * timebase.numer / timebase.denom / 1000000000.0;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+#endif
+}
 
 class Timer {
 public:
@@ -14,17 +31,15 @@ public:
     }
 
     void reset() {
-        gettimeofday(&start, NULL);
+        start = monotonicSeconds();
     }
 
     float getSeconds() {
-        struct timeval current;
-        gettimeofday(&current, NULL);
-        return current.tv_sec - start.tv_sec + (current.tv_usec  - start.tv_usec) / 1000000.0;
+        return monotonicSeconds() - start;
     }
 
 private:
-    struct timeval start;
+    double start;
 
 };
 
@@ -0,0 +1,286 @@
+// UniformBuffers.cpp
+// nativeGraphics
+// Uploads shader constants through uniform buffer objects, where supported
+
+#include "UniformBuffers.h"
+
+#include <cstring>
+
+#include "transform.h"
+#include "common.h"
+#include "log.h"
+
+UniformBuffers uniformBuffers;
+
+// Uniforms that live in the blocks when uniform buffers are on. Shaders'
+// own declarations of these are dropped by TranslateShader.
+static const char * blockUniforms[] = {
+    "u_PMatrix", "u_pT_Matrix", "u_FragWidth", "u_FragHeight", "u_Time",
+    "u_MVMatrix", "u_MVPMatrix", "u_Color", "u_Brightness"
+};
+
+static const char * blockDeclarations =
+    "layout(std140) uniform FrameConstants {\n"
+    "    mat4 u_PMatrix;\n"
+    "    mat4 u_pT_Matrix;\n"
+    "    int u_FragWidth;\n"
+    "    int u_FragHeight;\n"
+    "    float u_Time;\n"
+    "};\n"
+    "layout(std140) uniform ObjectConstants {\n"
+    "    mat4 u_MVMatrix;\n"
+    "    mat4 u_MVPMatrix;\n"
+    "    vec3 u_Color;\n"
+    "    float u_Brightness;\n"
+    "};\n";
+
+static bool UniformBuffersSupported() {
+#ifdef UNIFORM_BUFFERS
+#ifdef GLEW_ARB_uniform_buffer_object
+    // glewInit can fail without a window system (see headless.cpp), leaving
+    // the version flags unset even though the entry points loaded.
+    if(!glBindBufferRange || !glGetUniformBlockIndex || !glUniformBlockBinding ||
+       !glMapBufferRange || !glFenceSync || !glClientWaitSync)
+        return false;
+#endif
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    glGetError(); // GL 2 doesn't know these queries
+#ifdef GL_ES_VERSION_3_0
+    return major >= 3;
+#else
+    return major > 3 || (major == 3 && minor >= 2);
+#endif
+#else
+    return false;
+#endif // UNIFORM_BUFFERS
+}
+
+// Returns the name declared by a line like "uniform mat4 u_MVMatrix; // ...",
+// or an empty string if the line isn't a uniform declaration.
+static std::string DeclaredUniform(const std::string & line) {
+    size_t start = line.find_first_not_of(" \t");
+    if(start == std::string::npos || line.compare(start, 8, "uniform ") != 0)
+        return "";
+    size_t end = line.find(';', start);
+    if(end == std::string::npos)
+        return "";
+    size_t nameEnd = line.find_last_not_of(" \t", end - 1);
+    size_t nameStart = line.find_last_of(" \t", nameEnd);
+    return line.substr(nameStart + 1, nameEnd - nameStart);
+}
+
+UniformRing::UniformRing() : buffer(0), stride(0), slotsPerFrame(0), region(0), next(0) {
+}
+
+void UniformRing::Init(int blockSize, int slotsPerFrame) {
+#ifdef UNIFORM_BUFFERS
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    stride = (blockSize + alignment - 1) / alignment * alignment;
+    this->slotsPerFrame = slotsPerFrame;
+    region = 0;
+    next = 0;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, stride * slotsPerFrame * UNIFORM_RING_FRAMES, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    checkGlError("UniformRing::Init");
+#endif // UNIFORM_BUFFERS
+}
+
+void UniformRing::Release() {
+    if(buffer)
+        glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void UniformRing::BeginFrame(int region) {
+    this->region = region;
+    next = 0;
+}
+
+void UniformRing::Push(GLuint binding, const void * data, int size) {
+#ifdef UNIFORM_BUFFERS
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if(next == slotsPerFrame) {
+        // More draws than the region holds. Rather than wait for the GPU,
+        // orphan the buffer: draws already issued keep the old storage.
+        glBufferData(GL_UNIFORM_BUFFER, stride * slotsPerFrame * UNIFORM_RING_FRAMES, NULL, GL_STREAM_DRAW);
+        next = 0;
+    }
+
+    // The fence in UniformBuffers::BeginFrame guarantees the GPU is done
+    // with this region, so there's no need for the driver to synchronize.
+    GLintptr offset = (GLintptr) (region * slotsPerFrame + next) * stride;
+    void * dest = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if(dest) {
+        memcpy(dest, data, size);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    } else
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    checkGlError("UniformRing::Push");
+    next++;
+#endif // UNIFORM_BUFFERS
+}
+
+UniformBuffers::UniformBuffers() : enabled(false), frameNumber(0), frameValid(false) {
+#ifdef UNIFORM_BUFFERS
+    for(int i = 0; i < UNIFORM_RING_FRAMES; i++)
+        fences[i] = 0;
+#endif
+}
+
+void UniformBuffers::Init(bool allow) {
+    Release();
+    enabled = allow && UniformBuffersSupported();
+    if(!enabled)
+        return;
+
+    frameRing.Init(sizeof(FrameConstants), UNIFORM_FRAME_SLOTS);
+    objectRing.Init(sizeof(ObjectConstants), UNIFORM_OBJECT_SLOTS);
+    frameNumber = 0;
+    frameValid = false;
+    LOGI("Using uniform buffers for shader constants");
+}
+
+void UniformBuffers::Release() {
+    if(!enabled)
+        return;
+#ifdef UNIFORM_BUFFERS
+    for(int i = 0; i < UNIFORM_RING_FRAMES; i++) {
+        if(fences[i])
+            glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+#endif
+    frameRing.Release();
+    objectRing.Release();
+    enabled = false;
+}
+
+std::string UniformBuffers::TranslateShader(const char * source, GLenum shaderType) const {
+    if(!enabled || !source)
+        return source ? source : "";
+
+#ifdef GL_ES_VERSION_3_0
+    // Block members take the default precision where they're declared, and
+    // must match between stages.
+    std::string translated = "#version 300 es\nprecision highp float;\nprecision highp int;\n";
+#else
+    std::string translated = "#version 140\n";
+#endif
+    if(shaderType == GL_VERTEX_SHADER)
+        translated += "#define attribute in\n"
+                      "#define varying out\n";
+    else
+        translated += "#define varying in\n"
+                      "#define gl_FragColor o_FragColor\n"
+                      "out vec4 o_FragColor;\n";
+    translated += "#define texture2D texture\n";
+    translated += blockDeclarations;
+
+    const char * lineStart = source;
+    while(*lineStart) {
+        const char * lineEnd = strchr(lineStart, '\n');
+        if(!lineEnd)
+            lineEnd = lineStart + strlen(lineStart);
+        std::string line(lineStart, lineEnd);
+
+        std::string name = DeclaredUniform(line);
+        for(int i = 0; i < sizeof(blockUniforms) / sizeof(blockUniforms[0]); i++) {
+            if(name == blockUniforms[i]) {
+                line = "// " + line;
+                break;
+            }
+        }
+        translated += line + "\n";
+
+        lineStart = *lineEnd ? lineEnd + 1 : lineEnd;
+    }
+    return translated;
+}
+
+void UniformBuffers::BindBlocks(GLuint program) const {
+#ifdef UNIFORM_BUFFERS
+    if(!enabled || !program)
+        return;
+    GLuint frameBlock = glGetUniformBlockIndex(program, "FrameConstants");
+    if(frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, frameBlock, FRAME_BLOCK_BINDING);
+    GLuint objectBlock = glGetUniformBlockIndex(program, "ObjectConstants");
+    if(objectBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, objectBlock, OBJECT_BLOCK_BINDING);
+    checkGlError("glUniformBlockBinding");
+#endif // UNIFORM_BUFFERS
+}
+
+void UniformBuffers::BeginFrame() {
+#ifdef UNIFORM_BUFFERS
+    if(!enabled)
+        return;
+
+    // Normally long signalled, unless the GPU is more than
+    // UNIFORM_RING_FRAMES behind.
+    int region = frameNumber % UNIFORM_RING_FRAMES;
+    if(fences[region]) {
+        while(glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+    frameRing.BeginFrame(region);
+    objectRing.BeginFrame(region);
+    frameValid = false;
+#endif // UNIFORM_BUFFERS
+}
+
+void UniformBuffers::EndFrame() {
+#ifdef UNIFORM_BUFFERS
+    if(!enabled)
+        return;
+    fences[frameNumber % UNIFORM_RING_FRAMES] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frameNumber++;
+#endif // UNIFORM_BUFFERS
+}
+
+void UniformBuffers::SetFrame() {
+    float time = simClock.RenderTime();
+    if(frameValid && projectionVersion == projection.version() && frameWidth == pipeline->width &&
+       frameHeight == pipeline->height && frameTime == time)
+        return;
+
+    FrameConstants frame;
+    memcpy(frame.pMatrix, transforms.p().data(), sizeof(frame.pMatrix));
+    memcpy(frame.pInverseMatrix, transforms.pInverse().data(), sizeof(frame.pInverseMatrix));
+    frame.fragWidth = pipeline->width;
+    frame.fragHeight = pipeline->height;
+    frame.time = time;
+    frame.padding = 0.0f;
+    frameRing.Push(FRAME_BLOCK_BINDING, &frame, sizeof(frame));
+
+    frameValid = true;
+    projectionVersion = projection.version();
+    frameWidth = pipeline->width;
+    frameHeight = pipeline->height;
+    frameTime = time;
+}
+
+void UniformBuffers::SetObject(const float * color, float brightness) {
+    if(!enabled)
+        return;
+    SetFrame();
+
+    ObjectConstants object;
+    memcpy(object.mvMatrix, transforms.mv().data(), sizeof(object.mvMatrix));
+    memcpy(object.mvpMatrix, transforms.mvp().data(), sizeof(object.mvpMatrix));
+    for(int i = 0; i < 3; i++)
+        object.color[i] = color ? color[i] : 1.0f;
+    object.brightness = brightness;
+    objectRing.Push(OBJECT_BLOCK_BINDING, &object, sizeof(object));
+}
@@ -0,0 +1,118 @@
+// UniformBuffers.h
+// nativeGraphics
+// Uploads shader constants through uniform buffer objects, where supported
+
+#ifndef __nativeGraphics__UniformBuffers__
+#define __nativeGraphics__UniformBuffers__
+
+#include <string>
+
+#include "graphics_header.h"
+
+// Needs GL 3.2 (uniform buffers and sync objects) or GLES 3. The GLES2
+// headers used on Android and iOS declare neither, so there every constant is
+// still set with glUniform*.
+#if defined(GL_UNIFORM_BUFFER) && defined(GL_SYNC_GPU_COMMANDS_COMPLETE) && !defined(ANDROID_NDK)
+#define UNIFORM_BUFFERS
+#endif
+
+#define UNIFORM_RING_FRAMES 3 // Frames of constants the GPU may still be reading
+#define UNIFORM_FRAME_SLOTS 4 // Frame blocks per frame, one per projection change
+#define UNIFORM_OBJECT_SLOTS 1024 // Object blocks per frame, before orphaning
+
+#define FRAME_BLOCK_BINDING 0
+#define OBJECT_BLOCK_BINDING 1
+
+// std140 layouts of the blocks declared by UniformBuffers::TranslateShader.
+// Each member is named after the uniform it replaces.
+struct FrameConstants {
+    float pMatrix[16]; // u_PMatrix
+    float pInverseMatrix[16]; // u_pT_Matrix
+    GLint fragWidth; // u_FragWidth
+    GLint fragHeight; // u_FragHeight
+    float time; // u_Time
+    float padding;
+};
+
+struct ObjectConstants {
+    float mvMatrix[16]; // u_MVMatrix
+    float mvpMatrix[16]; // u_MVPMatrix
+    float color[3]; // u_Color
+    float brightness; // u_Brightness
+};
+
+// One uniform buffer split into UNIFORM_RING_FRAMES regions, so a frame's
+// writes never touch storage an earlier frame's draws may still read.
+class UniformRing {
+public:
+    UniformRing();
+
+    void Init(int blockSize, int slotsPerFrame);
+    void Release();
+
+    // Starts writing at the beginning of region, which must no longer be in use.
+    void BeginFrame(int region);
+
+    // Copies a block into the next free slot and binds it to binding.
+    void Push(GLuint binding, const void * data, int size);
+
+private:
+    GLuint buffer;
+    int stride; // Block size, rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    int slotsPerFrame;
+    int region;
+    int next; // Slot within region
+};
+
+// Shared per-frame constants (projection, viewport size, time) are uploaded
+// once into one block, and per-draw constants (transforms, light color) into
+// a second, instead of with glUniform* calls for each draw. Shaders are still
+// written in GLSL ES 1.0; TranslateShader adapts them.
+class UniformBuffers {
+public:
+    UniformBuffers();
+
+    // Must be called on the GL thread once the context exists, before any
+    // shaders are compiled. Uniform buffers stay off if unsupported, or if
+    // allow is false.
+    void Init(bool allow);
+    void Release();
+    bool IsEnabled() const { return enabled; }
+
+    // Rewrites a GLSL ES 1.0 shader for the block layouts above: adds a
+    // #version line and the block declarations, and drops the uniforms they
+    // replace. Returns source unchanged if uniform buffers are off.
+    std::string TranslateShader(const char * source, GLenum shaderType) const;
+
+    // Points a linked program's blocks at their binding points.
+    void BindBlocks(GLuint program) const;
+
+    void BeginFrame();
+    void EndFrame();
+
+    // Uploads the current transforms for the next draw, along with new frame
+    // constants if the projection, viewport or time changed.
+    void SetObject(const float * color = NULL, float brightness = 0.0f);
+
+private:
+    void SetFrame();
+
+    bool enabled;
+    int frameNumber;
+    UniformRing frameRing;
+    UniformRing objectRing;
+#ifdef UNIFORM_BUFFERS
+    GLsync fences[UNIFORM_RING_FRAMES]; // Signalled once the GPU is done with each region
+#endif
+
+    // What the current frame block was built from
+    bool frameValid;
+    unsigned int projectionVersion;
+    int frameWidth;
+    int frameHeight;
+    float frameTime;
+};
+
+extern UniformBuffers uniformBuffers;
+
+#endif // __nativeGraphics__UniformBuffers__
@@ -17,8 +17,11 @@
 #include "RenderLight.h"
 #include "RenderDestructible.h"
 #include "Fluid.h"
-#include "Timer.h"
 #include "glsl_helper.h"
+#include "UniformBuffers.h"
+#include "TiledLighting.h"
+#include "DynamicResolution.h"
+#include "RenderState.h"
 #include "log.h"
 
 #include "levels/basicLevel.h"
@@ -28,6 +31,9 @@ using namespace std;
 using Eigen::Matrix4f;
 using Eigen::Vector4f;
 
+// Seconds per frame spent uploading finished assets to GL
+#define ASSET_UPLOAD_BUDGET 0.004f
+
 int displayWidth = 0;
 int displayHeight = 0;
 bool touchDown = false;
@@ -35,6 +41,16 @@ float lastTouch[2] = {0,0};
 float orientation[3] = {0,0,0};
 GLuint defaultFrameBuffer = 0;
 RenderPipeline * pipeline = NULL;
+AssetLoader * assetLoader = NULL;
+ResourceCache * resourceCache = NULL;
+SimulationClock simClock;
+Profiler profiler;
+bool allowUniformBuffers = true;
+bool allowInstancing = true;
+bool allowPreciseDepth = true;
+bool allowTiledLighting = true;
+float renderScale = 1.0f;
+float targetFrameRate = 0.0f;
 
 basicLevel * level = NULL;
 
@@ -49,6 +65,31 @@ void SetResourceCallback(void*(*cb)(const char *, int *, int *)) {
     resourceCallback = cb;
 }
 
+// Callback functions to load binary resources.
+void*(*binaryResourceCallback)(const char *, int *) = NULL;
+void(*releaseBinaryResourceCallback)(void *, int) = NULL;
+
+void * loadBinaryResource(const char * fileName, int * size) {
+    if(!binaryResourceCallback)
+        return NULL;
+    return binaryResourceCallback(fileName, size);
+}
+
+void releaseBinaryResource(void * data, int size) {
+    if(releaseBinaryResourceCallback)
+        releaseBinaryResourceCallback(data, size);
+}
+
+void SetBinaryResourceCallback(void*(*cb)(const char *, int *), void(*releasecb)(void *, int)) {
+    binaryResourceCallback = cb;
+    releaseBinaryResourceCallback = releasecb;
+}
+
+void SetResourceCache(const char * directory, bool(*statfunc)(const char *, long *, long *)) {
+    delete resourceCache;
+    resourceCache = new ResourceCache(directory, statfunc);
+}
+
 void loadLevel() {
     if (level != NULL) {
         level->FreeLevel();
@@ -64,18 +105,70 @@ void Setup(int w, int h) {
     }
     displayWidth = w;
     displayHeight = h;
-    pipeline = new RenderPipeline();
+    renderState.Invalidate(); // Cached names may be from a previous context
+    clearShaderMacros(); // Setup runs again whenever the context is recreated
+    uniformBuffers.Init(allowUniformBuffers); // Before any shaders are compiled
+    RenderObject::InitInstancing(allowInstancing);
+    pipeline = new RenderPipeline(allowPreciseDepth, renderScale); // Before any shaders are compiled
+    tiledLighting.Init(allowTiledLighting);
+    dynamicResolution.Init(targetFrameRate, pipeline->RenderScale());
+    if(!assetLoader)
+        assetLoader = new AssetLoader();
 
     loadLevel();
+    simClock.Reset();
 }
 
 void setFrameBuffer(int handle) {
     defaultFrameBuffer = handle;
 }
 
+void SetFixedFrameTime(float seconds) {
+    simClock.SetFixedFrameTime(seconds);
+}
+
+void SetUniformBuffers(bool enabled) {
+    allowUniformBuffers = enabled;
+}
+
+void SetInstancing(bool enabled) {
+    allowInstancing = enabled;
+}
+
+void SetPreciseDepth(bool enabled) {
+    allowPreciseDepth = enabled;
+}
+
+void SetTiledLighting(bool enabled) {
+    allowTiledLighting = enabled;
+}
+
+void SetRenderScale(float scale) {
+    renderScale = scale;
+}
+
+void SetTargetFrameRate(float framesPerSecond) {
+    targetFrameRate = framesPerSecond;
+}
+
 void RenderFrame() {
-    pipeline->ClearBuffers();
+    profiler.BeginFrame();
+    renderState.BeginFrame(); // The platform layer may have changed anything
+    {
+        PROFILE_ZONE("AssetLoader::Update");
+        assetLoader->Update(ASSET_UPLOAD_BUDGET);
+    }
+    simClock.Advance();
+    if(dynamicResolution.Update())
+        pipeline->SetRenderScale(dynamicResolution.Scale());
+    uniformBuffers.BeginFrame();
+    {
+        PROFILE_ZONE("ClearBuffers");
+        pipeline->ClearBuffers();
+    }
     level->RenderFrame();
+    uniformBuffers.EndFrame();
+    profiler.EndFrame();
     fpsMeter();
 }
 
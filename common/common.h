@@ -2,14 +2,46 @@
 #define __nativeGraphics__common__
 
 #include "RenderPipeline.h"
+#include "AssetLoader.h"
+#include "ResourceCache.h"
+#include "SimulationClock.h"
+#include "Profiler.h"
 
 
 /** This part of the interface is called by the "upper" level of the program.
     (Android Java, iOS Obj-C, Linux C++.                                  **/
 void SetResourceCallback(void*(*callbackfunc)(const char *, int *, int *));
+void SetBinaryResourceCallback(void*(*callbackfunc)(const char *, int *), void(*releasefunc)(void *, int));
+// Optional: caches parsed meshes and decoded textures in directory. statfunc
+// reports a resource's size and modification time (false if missing).
+void SetResourceCache(const char * directory, bool(*statfunc)(const char *, long *, long *));
 void Setup(int w, int h);
 void setFrameBuffer(int handle);
 void RenderFrame();
+// Optional: simulate each frame as if this many seconds passed (0 for real
+// time), making runs reproducible.
+void SetFixedFrameTime(float seconds);
+// Optional: false uploads shader constants with glUniform* even where uniform
+// buffers are supported. Must be called before Setup.
+void SetUniformBuffers(bool enabled);
+// Optional: false draws instances one at a time, as on GLES2, even where
+// hardware instancing is supported. Must be called before Setup.
+void SetInstancing(bool enabled);
+// Optional: false keeps 8-bit depth in the g buffer's alpha, as without depth
+// textures, for lights and picking. Must be called before Setup.
+void SetPreciseDepth(bool enabled);
+// Optional: false draws each light's volume on its own, instead of shading
+// them together over screen tiles. Must be called before Setup.
+void SetTiledLighting(bool enabled);
+// Optional: draws the g buffer and lights at this fraction of the display's
+// size, from .5 to 1, and scales the lit result up. Must be called before
+// Setup.
+void SetRenderScale(float scale);
+// Optional: lowers the render scale, down to .5, while frames take longer
+// than this rate allows, and raises it back towards SetRenderScale's when
+// they're quick again. 0, the default, keeps it fixed. Must be called before
+// Setup.
+void SetTargetFrameRate(float framesPerSecond);
 
 // Note that these may be called asynchronously with RenderFrame
 void PointerDown(float x, float y, int pointerIndex = -1);
@@ -23,6 +55,10 @@ void UpdateOrientation(float roll, float pitch, float yaw);
 // Callback function to load resources.
 extern void * loadResource(const char *, int * width = NULL, int * height = NULL);
 
+// Callback functions to load raw binary resources (optional, may return NULL).
+extern void * loadBinaryResource(const char *, int * size);
+extern void releaseBinaryResource(void *, int size);
+
 // Globally accessible variables
 extern int displayWidth;
 extern int displayHeight;
@@ -31,5 +67,9 @@ extern float lastTouch[2];
 extern float orientation[3];
 extern GLuint defaultFrameBuffer;
 extern RenderPipeline * pipeline;
+extern AssetLoader * assetLoader;
+extern ResourceCache * resourceCache; // NULL unless SetResourceCache was called
+extern SimulationClock simClock;
+extern Profiler profiler; // Disabled until profiler.Enable() is called
 
 #endif // __nativeGraphics__common__
\ No newline at end of file
@@ -4,11 +4,92 @@
 
 #include "glsl_helper.h"
 
+#include <cstdio>
 #include <cstdlib>
+#include <string>
 
+#include "UniformBuffers.h"
 #include "log.h"
 
+static std::map<GLuint, ShaderLocations> programLocations;
+static std::string shaderDefines;
+
+void ShaderLocations::Reflect(GLuint program) {
+    uniforms.clear();
+    attributes.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(maxLength + 1, '\0');
+    for(int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, name.size(), &length, &size, &type, &name[0]);
+        std::string uniform(name.c_str(), length);
+        GLint location = glGetUniformLocation(program, uniform.c_str());
+        if(location == -1)
+            continue; // Built-in, or a member of a uniform block
+        if(uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+            uniform.resize(uniform.size() - 3);
+        uniforms[uniform] = location;
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.assign(maxLength + 1, '\0');
+    for(int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(program, i, name.size(), &length, &size, &type, &name[0]);
+        std::string attribute(name.c_str(), length);
+        GLint location = glGetAttribLocation(program, attribute.c_str());
+        if(location != -1)
+            attributes[attribute] = location;
+    }
+    checkGlError("ShaderLocations::Reflect");
+}
+
+GLint ShaderLocations::Uniform(const char * name) const {
+    std::map<std::string, GLint>::const_iterator i = uniforms.find(name);
+    return i == uniforms.end() ? -1 : i->second;
+}
+
+GLint ShaderLocations::Attribute(const char * name) const {
+    std::map<std::string, GLint>::const_iterator i = attributes.find(name);
+    return i == attributes.end() ? -1 : i->second;
+}
+
+const ShaderLocations & shaderLocations(GLuint program) {
+    return programLocations[program];
+}
+
+void defineShaderMacro(const char * name) {
+    shaderDefines += std::string("#define ") + name + "\n";
+}
+
+void defineShaderMacro(const char * name, float value) {
+    char literal[32];
+    snprintf(literal, sizeof(literal), "%#g", value); // Always has a point, as GLSL floats need
+    shaderDefines += std::string("#define ") + name + " " + literal + "\n";
+}
+
+void clearShaderMacros() {
+    shaderDefines.clear();
+}
+
 GLuint loadShader(GLenum shaderType, const char* pSource) {
+    std::string translated = uniformBuffers.TranslateShader(pSource, shaderType);
+    if(!shaderDefines.empty()) {
+        // #version has to stay the first line
+        size_t start = 0;
+        if(translated.compare(0, 8, "#version") == 0)
+            start = translated.find('\n') + 1;
+        translated.insert(start, shaderDefines);
+    }
+    pSource = translated.c_str();
     GLuint shader = glCreateShader(shaderType);
     if(shader) {
         glShaderSource(shader, 1, &pSource, NULL);
@@ -70,6 +151,9 @@ GLuint createShaderProgram(const char* pVertexSource, const char* pFragmentSourc
             glDeleteProgram(program);
             program = 0;
         }
+        uniformBuffers.BindBlocks(program);
+        if(program)
+            programLocations[program].Reflect(program);
     }
     return program;
 }
@@ -5,8 +5,38 @@
 #ifndef __nativeGraphics__glsl_helper__
 #define __nativeGraphics__glsl_helper__
 
+#include <map>
+#include <string>
+
 #include "graphics_header.h"
 
+// Locations of a program's active uniforms and attributes, reflected once
+// when it's linked, so draws never have to ask the driver by name.
+class ShaderLocations {
+public:
+    void Reflect(GLuint program);
+
+    // -1 if the program has no such active uniform or attribute
+    GLint Uniform(const char * name) const;
+    GLint Attribute(const char * name) const;
+
+private:
+    std::map<std::string, GLint> uniforms; // Arrays are listed without "[0]"
+    std::map<std::string, GLint> attributes;
+};
+
+// Defines name (to nothing) in every shader compiled from now on, so shader
+// files can #ifdef on options like the g-buffer layout.
+void defineShaderMacro(const char * name);
+// Defines name as a float constant, for values shared with the C++ side
+void defineShaderMacro(const char * name, float value);
+// Forgets every macro defined so far, for a new context to define its own
+void clearShaderMacros();
+
 GLuint createShaderProgram(const char* pVertexSource = NULL, const char* pFragmentSource = NULL);
 
+// The locations of a program made by createShaderProgram. Look them up once,
+// e.g. at construction, rather than every draw.
+const ShaderLocations & shaderLocations(GLuint program);
+
 #endif // __nativeGraphics__glsl_helper__
@@ -56,6 +56,7 @@ basicLevel::basicLevel(const char * mazeFile) {
     destructible->AddTexture("submarine_albedo.jpg", false);
     
     bigLight = new RenderLight("square.obj", "dr_square_v.glsl", "dr_pointlight_f.glsl");
+    bigLight->cull = false; // Covers the screen, wherever the light is
     
     hud = new HUD();
     health = 1.0f;
@@ -92,18 +93,22 @@ void basicLevel::RenderFrame() {
     
     /** Any geometry that will be collision detected
         should be rendered here, before user input. **/
-    mvPushMatrix();
-    scalef(40);
-    cave->Render();
-    mvPopMatrix();
+    {
+        PROFILE_ZONE("cave->Render");
+        mvPushMatrix();
+        scalef(40);
+        cave->Submit();
+        mvPopMatrix();
+        // Picking and collisions read the cave back from the g buffer
+        renderQueue.Flush();
+    }
     
     // Process user input
     if(touchDown) {
         /*uint8_t * geometry = pipeline->RayTracePixel(lastTouch[0], 1.0f - lastTouch[1], true);
         if(geometry[3] != 255) {
             float depth = geometry[3] / 128.0f - 1.0f;            
-            Matrix4f mvp = projection.top()*model_view.top();
-            Eigen::Vector4f pos = mvp.inverse() * Eigen::Vector4f((lastTouch[0]) * 2.0f - 1.0f, (1.0 - lastTouch[1]) * 2.0f - 1.0f, depth, 1.0);
+            Eigen::Vector4f pos = transforms.mvpInverse() * Eigen::Vector4f((lastTouch[0]) * 2.0f - 1.0f, (1.0 - lastTouch[1]) * 2.0f - 1.0f, depth, 1.0);
             character->instances[0].targetPosition = Vector3f(pos(0) / pos(3), pos(1) / pos(3), pos(2) / pos(3));
         }
         delete[] geometry;*/
@@ -111,17 +116,21 @@ void basicLevel::RenderFrame() {
     
     cameraPan = (1.0 - PAN_LERP_FACTOR) * cameraPan + PAN_LERP_FACTOR * character->instances[0].position;
         
-    // Run physics.
-    character->Update();
+    // Run physics in fixed steps.
+    while(simClock.Step()) {
+        PROFILE_ZONE("character->Update");
+        character->Update(simClock.Dt());
+    }
+    Vector3f characterPosition = character->instances[0].RenderPosition(simClock.Alpha());
     
     mvPushMatrix();
-    translate(character->instances[0].position);
+    translate(characterPosition);
     rotate(0.0, character->instances[0].rot[0], character->instances[0].rot[1]);
     scalef(.15f);
     if (health < .05) {
-        destructible->Render();
+        destructible->Submit();
     } else {
-        character->Render();
+        character->Submit();
     }
     mvPopMatrix();
     
@@ -129,15 +138,17 @@ void basicLevel::RenderFrame() {
     // Using g buffer, render lights
     
     mvPushMatrix();
-    translate(character->instances[0].position);
+    translate(characterPosition);
     bigLight->color[0] = 1.0;
     bigLight->color[1] = 1.0;
     bigLight->color[2] = 0.8;
     bigLight->brightness = 16000.0;// * health;
-    bigLight->Render();
+    bigLight->Submit();
     mvPopMatrix();
     
     //hud->Render(0.8f);
+
+    renderQueue.Flush();
 }
 
 
@@ -31,10 +31,9 @@ private:
     
     
     bool shotBomb;
-    Timer frameRate;
     
     bool dead;
-    Timer deathTimer;
+    double deathTime; // simClock.Time() when the character died
     
     Vector3f goal;
 };
@@ -59,8 +58,6 @@ level1::level1(const char * mazeFile, Vector3f target) : basicLevel(mazeFile) {
     
     goal = target;
     
-    frameRate.reset();
-    
     dead = false;
 
 }
@@ -73,7 +70,7 @@ void level1::RestartLevel() {
     cameraPan = Vector3f(0, 200, 0);
 
     health = 1.0;
-    character->instances[0].position = Vector3f(0,0,0);
+    character->instances[0].Teleport(Vector3f(0,0,0));
     character->instances[0].targetPosition = Vector3f(0,0,0);
     character->instances[0].velocity = Vector3f(0,0,0);
     jellyfish->instances.clear();
@@ -89,7 +86,7 @@ void level1::RestartLevel() {
 
 void level1::addJellyfish() {
     struct characterInstance instance;
-    instance.position = character->instances[0].position + 600.0f * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f);
+    instance.Teleport(character->instances[0].position + 600.0f * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f));
     instance.MaxAcceleration = 200.0f;
     instance.Drag = 100.0f;
     instance.MaxVelocity = 100.0f;
@@ -98,7 +95,7 @@ void level1::addJellyfish() {
 
 void level1::addsmall_jellyfish() {
     struct characterInstance instance;
-    instance.position = character->instances[0].position + 600.0f * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f);
+    instance.Teleport(character->instances[0].position + 600.0f * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f));
     instance.MaxAcceleration = 300.0f;
     instance.Drag = 100.0f;
     instance.MaxVelocity = 150.0f;
@@ -109,10 +106,10 @@ void level1::RenderFrame() {
     
     if(health <= 0.0f && !dead) {
         dead = true;
-        deathTimer.reset();
+        deathTime = simClock.Time();
     }
     
-    if(dead && deathTimer.getSeconds() > 4.0)
+    if(dead && simClock.Time() - deathTime > 4.0)
         RestartLevel();
     
     // Setup perspective matrices
@@ -128,19 +125,23 @@ void level1::RenderFrame() {
     
     /** Any geometry that will be collision detected
         should be rendered here, before user input. **/
-    mvPushMatrix();
-    scalef(200);
-    cave->Render();
-    mvPopMatrix();
+    {
+        PROFILE_ZONE("cave->Render");
+        mvPushMatrix();
+        scalef(200);
+        cave->Submit();
+        mvPopMatrix();
+        // Picking and collisions read the cave back from the g buffer
+        renderQueue.Flush();
+    }
     
     // Process user input
     if(!dead) {
         if(touchDown) {
-            uint8_t depthb = pipeline->getDepth(lastTouch[0], 1.0f - lastTouch[1]);
-            if(depthb != 255) {
-                float depth = depthb / 128.0f - 1.0f;            
-                Matrix4f mvp = projection.top()*model_view.top();
-                Eigen::Vector4f pos = mvp.inverse() * Eigen::Vector4f((lastTouch[0]) * 2.0f - 1.0f, (1.0 - lastTouch[1]) * 2.0f - 1.0f, depth, 1.0);
+            float windowDepth = pipeline->getDepth(lastTouch[0], 1.0f - lastTouch[1]);
+            if(windowDepth < 1.0f) {
+                float depth = 2.0f * windowDepth - 1.0f;
+                Eigen::Vector4f pos = transforms.mvpInverse() * Eigen::Vector4f((lastTouch[0]) * 2.0f - 1.0f, (1.0 - lastTouch[1]) * 2.0f - 1.0f, depth, 1.0);
                 character->instances[0].targetPosition = Vector3f(pos(0) / pos(3), pos(1) / pos(3), pos(2) / pos(3));
             }
         }
@@ -150,7 +151,7 @@ void level1::RenderFrame() {
             
         if(touchDown && !shotBomb) {
             struct physicsInstance newBomb;
-            newBomb.position = character->instances[0].position;
+            newBomb.Teleport(character->instances[0].position);
             newBomb.velocity = 200.0f * Eigen::Vector3f(-cos(character->instances[0].rot[0]), 1.0f, sin(character->instances[0].rot[0]));
             bomb->instances.push_back(newBomb);
             shotBomb = true;
@@ -166,135 +167,140 @@ void level1::RenderFrame() {
             addsmall_jellyfish();
     }
    
-    float timeSinceLast = frameRate.getSeconds();
-    frameRate.reset();
-    // Run physics.
-    bomb->Update();
-    character->Update();
-    for(int i = 0; i < jellyfish->instances.size(); i++) {
-        jellyfish->instances[i].targetPosition = character->instances[0].position;
-        // Randomize movement
-        float dist = (character->instances[0].position - jellyfish->instances[i].position).norm();
-        if(dist < 50.0f)
-            health -= .05f * timeSinceLast;
-        jellyfish->instances[i].targetPosition += 1.1f * dist * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f);
+    // Once a frame, however many steps there are to catch up on
+    bomb->Collide();
+    
+    // Run physics in fixed steps, so results don't depend on frame rate.
+    while(simClock.Step()) {
+        PROFILE_ZONE("Simulate");
+        float dt = simClock.Dt();
+        bomb->Update(dt);
+        {
+            PROFILE_ZONE("character->Update");
+            character->Update(dt);
+        }
+        for(int i = 0; i < jellyfish->instances.size(); i++) {
+            jellyfish->instances[i].targetPosition = character->instances[0].position;
+            // Randomize movement
+            float dist = (character->instances[0].position - jellyfish->instances[i].position).norm();
+            if(dist < 50.0f)
+                health -= .05f * dt;
+            jellyfish->instances[i].targetPosition += 1.1f * dist * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f);
+        }
+        for(int i = 0; i < small_jellyfish->instances.size(); i++) {
+            small_jellyfish->instances[i].targetPosition = character->instances[0].position;
+            // Randomize movement
+            float dist = (character->instances[0].position - small_jellyfish->instances[i].position).norm();
+            if(dist < 50.0f)
+                health -= .1f * dt;
+            small_jellyfish->instances[i].targetPosition += 1.1f * dist * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f);
+        }
+        health = min(health + .01f * dt, 1.0f);
+        if(goalReached) {
+            transitionLight += .2f * dt;
+            health = min(health + 1.0f * dt, 1.0f);
+        }
+        health = max(health, 0.0f);
+        jellyfish->Update(dt);
+        small_jellyfish->Update(dt);
     }
-    for(int i = 0; i < small_jellyfish->instances.size(); i++) {
-        small_jellyfish->instances[i].targetPosition = character->instances[0].position;
-        // Randomize movement
-        float dist = (character->instances[0].position - small_jellyfish->instances[i].position).norm();
-        if(dist < 50.0f)
-            health -= .1f * timeSinceLast;
-        small_jellyfish->instances[i].targetPosition += 1.1f * dist * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f);
+    {
+        PROFILE_ZONE("Water->Update");
+        Water->Update();
     }
-    health = min(health + .01f * timeSinceLast, 1.0f);
-    health = max(health, 0.0f);
-    jellyfish->Update();
-    small_jellyfish->Update();
-    Water->Update();
+    
+    // Draw everything between the last two steps.
+    float alpha = simClock.Alpha();
+    Vector3f characterPosition = character->instances[0].RenderPosition(alpha);
     
     mvPushMatrix();
-    translate(character->instances[0].position);
+    translate(characterPosition);
     rotate(0.0, character->instances[0].rot[0], character->instances[0].rot[1]);
     scalef(.15f);
     if(dead)
-        destructible->Render();
+        destructible->Submit();
     else
-        character->Render();
+        character->Submit();
     mvPopMatrix();
 
     mvPushMatrix();
-    translate(character->instances[0].position);
+    translate(characterPosition);
     rotate(0.0, character->instances[0].rot[0], character->instances[0].rot[1]);
     scalef(10.00f);
     translate(Vector3f(2.5,-0.5,-2));
     rotatef(90, 0,0,-1);
-    Water->Render(0,0,0);
+    Water->Submit();
     mvPopMatrix();
     
-    for(int i = 0; i < jellyfish->instances.size(); i++) {
-        mvPushMatrix();
-        translate(jellyfish->instances[i].position);
-        rotate(0.0, jellyfish->instances[i].rot[0], jellyfish->instances[i].rot[1]);
-        rotate(0.0, 0.0, (float) M_PI / 2.0f);
-        scalef(1.0f);
-        jellyfish->Render(i);
-        mvPopMatrix();
-    }
-    
-    for(int i = 0; i < small_jellyfish->instances.size(); i++) {
-        mvPushMatrix();
-        translate(small_jellyfish->instances[i].position);
-        rotate(0.0, small_jellyfish->instances[i].rot[0], small_jellyfish->instances[i].rot[1]);
-        rotate(0.0, 0.0, (float) M_PI / 2.0f);
-        scalef(0.7f);
-        small_jellyfish->Render(i);
-        mvPopMatrix();
-    }
-    
-    for(int i = 0; i < bomb->instances.size(); i++) {
-        if(bomb->instances[i].timer.getSeconds() <= BOMB_TIMER_LENGTH) {
-            mvPushMatrix();
-            translate(bomb->instances[i].position);
-            scalef(4);
-            bomb->Render(i);
-            mvPopMatrix();
-        }
-    }
+    // One instanced draw each. The jellyfish model faces along x.
+    mvPushMatrix();
+    mvLoadIdentity();
+    rotate(0.0, 0.0, (float) M_PI / 2.0f);
+    Matrix4f jellyfishModel = model_view.top();
+    scalef(0.7f);
+    Matrix4f smallJellyfishModel = model_view.top();
+    mvLoadIdentity();
+    scalef(4);
+    Matrix4f bombModel = model_view.top();
+    mvPopMatrix();
+
+    jellyfish->SubmitAll(alpha, jellyfishModel);
+    small_jellyfish->SubmitAll(alpha, smallJellyfishModel);
+    bomb->SubmitAll(alpha, bombModel, BOMB_TIMER_LENGTH);
     
     // Render the goal
     mvPushMatrix();
     translate(goal);
     scalef(50);
-    bomb->Render(0);
+    bomb->Submit(0);
     mvPopMatrix();
 
     ////////////////////////////////////////////////////
     // Using g buffer, render lights
     
     mvPushMatrix();
-    translate(character->instances[0].position);
+    translate(characterPosition);
     bigLight->color[0] = 1.0 - .1 * transitionLight;
     bigLight->color[1] = 1.0;
     bigLight->color[2] = 0.8 - .1 * transitionLight;
     bigLight->brightness = 32000.0 * health + 320000.0 * transitionLight;
-    bigLight->Render();
+    bigLight->Submit();
     mvPopMatrix();
     
     if(dead) {
         mvPushMatrix();
-        translate(character->instances[0].position + 40.0f * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f));
+        translate(characterPosition + 40.0f * Vector3f((rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f, (rand() % 200 - 100) / 100.0f));
         scalef(250);
         explosiveLight->color[0] = 1.00f;
         explosiveLight->color[1] = 0.33f;
         explosiveLight->color[2] = 0.07f;
         explosiveLight->brightness = 10000000.0f;
-        explosiveLight->Render();
+        explosiveLight->Submit();
         mvPopMatrix();
     }
     
     for(int i = 0; i < bomb->instances.size(); i++) {
-        if(bomb->instances[i].timer.getSeconds() <= BOMB_TIMER_LENGTH) {
+        if(bomb->instances[i].age <= BOMB_TIMER_LENGTH) {
             mvPushMatrix();
-            translate(bomb->instances[i].position);
+            translate(bomb->instances[i].RenderPosition(alpha));
             scalef(100);
             smallLight->color[0] = 1.00f;
             smallLight->color[1] = 0.33f;
             smallLight->color[2] = 0.07f;
-            smallLight->brightness = 1500 + 1500 * sin(bomb->instances[i].timer.getSeconds() * 4.0f * M_PI);
-            smallLight->Render();
+            smallLight->brightness = 1500 + 1500 * sin(bomb->instances[i].age * 4.0f * M_PI);
+            smallLight->Submit();
             mvPopMatrix();
-        } else if(bomb->instances[i].timer.getSeconds() <= BOMB_TIMER_LENGTH + BOMB_EXPLOSION_LENGTH) {
+        } else if(bomb->instances[i].age <= BOMB_TIMER_LENGTH + BOMB_EXPLOSION_LENGTH) {
             mvPushMatrix();
-            translate(bomb->instances[i].position);
+            translate(bomb->instances[i].RenderPosition(alpha));
             scalef(250);
             explosiveLight->color[0] = 1.00f;
             explosiveLight->color[1] = 1.00f;
             explosiveLight->color[2] = 1.00f;
-            float explosionTime = (bomb->instances[i].timer.getSeconds() - BOMB_TIMER_LENGTH) / BOMB_EXPLOSION_LENGTH;
+            float explosionTime = (bomb->instances[i].age - BOMB_TIMER_LENGTH) / BOMB_EXPLOSION_LENGTH;
             float intensity = sin(M_PI * sqrt(explosionTime));
             explosiveLight->brightness = 10000000.0f * intensity;
-            explosiveLight->Render();
+            explosiveLight->Submit();
             mvPopMatrix();
             for(int j = 0; j < jellyfish->instances.size(); j++) {
                 if((jellyfish->instances[j].position - bomb->instances[i].position).norm() < 200) {
@@ -320,7 +326,7 @@ void level1::RenderFrame() {
     
     if(!dead) {
         mvPushMatrix();
-        translate(character->instances[0].position);
+        translate(characterPosition);
         rotate(0.0, character->instances[0].rot[0], character->instances[0].rot[1]);
         rotate(0.0,0,-M_PI / 2.0f);
         scalef(300.0f);
@@ -328,7 +334,7 @@ void level1::RenderFrame() {
         spotLight->color[1] = 0.6f;
         spotLight->color[2] = 1.0f;
         spotLight->brightness = 16000.0;
-        spotLight->Render();
+        spotLight->Submit();
         mvPopMatrix();
     }
     
@@ -340,20 +346,19 @@ void level1::RenderFrame() {
     explosiveLight->color[1] = 1.0f;
     explosiveLight->color[2] = 0.8f;
     explosiveLight->brightness = 10000000.0f;
-    explosiveLight->Render();
+    explosiveLight->Submit();
     mvPopMatrix();
     
     if((goal - character->instances[0].position).norm() <= 200.0f)
         goalReached = true;
     
-    if(goalReached) {
-        transitionLight += .2f * timeSinceLast;
-        health = min(health + 1.0f * timeSinceLast, 1.0f);
-    }
-    
     if(transitionLight >= 1.0f)
         RestartLevel();
     
+    renderQueue.Flush();
+    
+    // Drawn in a flush of its own, last, so it's timed apart from the rest
+    PROFILE_ZONE("hud->Render");
     hud->Render(health);
     hud->ShowRadar(goal - character->instances[0].position, 0, .01f);
     
@@ -362,6 +367,8 @@ void level1::RenderFrame() {
     
     for(int i = 0; i < small_jellyfish->instances.size(); i++)
          hud->ShowRadar(small_jellyfish->instances[i].position - character->instances[0].position, 1, .004f);
+
+    renderQueue.Flush();
 }
 
 #endif // __nativeGraphics_levels_simpleLevel1__
@@ -0,0 +1,80 @@
+// mesh_format.cpp
+// nativeGraphics
+// Versioned binary mesh files, precompiled offline from obj files by meshconvert
+
+#include "mesh_format.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "log.h"
+
+std::string meshFileName(const char * objFilename) {
+    std::string name(objFilename);
+    size_t dot = name.rfind('.');
+    if(dot != std::string::npos)
+        name.erase(dot);
+    return name + "_mesh.bin";
+}
+
+bool writeMeshFile(const char * path, const float * vertexBuffer, int numVertices, int floatsPerVertex, const unsigned int * indices, int numIndices) {
+    FILE * file = fopen(path, "wb");
+    if(!file) {
+        LOGE("Unable to open %s for writing", path);
+        return false;
+    }
+
+    struct MeshFileHeader header;
+    memcpy(header.magic, MESH_FILE_MAGIC, 4);
+    header.version = MESH_FILE_VERSION;
+    header.floatsPerVertex = floatsPerVertex;
+    header.numVertices = numVertices;
+    header.numIndices = numIndices;
+    header.indexSize = numVertices <= 65536 ? 2 : 4;
+
+    size_t numFloats = (size_t) numVertices * floatsPerVertex;
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1
+                && fwrite(vertexBuffer, sizeof(float), numFloats, file) == numFloats;
+    if(header.indexSize == 2) {
+        std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+        success = success && fwrite(&shortIndices[0], sizeof(uint16_t), numIndices, file) == (size_t) numIndices;
+    } else {
+        success = success && fwrite(indices, sizeof(uint32_t), numIndices, file) == (size_t) numIndices;
+    }
+    if(fclose(file) != 0)
+        success = false;
+    if(!success) {
+        LOGE("Error writing mesh file %s", path);
+    }
+    return success;
+}
+
+const float * readMeshFile(const void * data, int size, int & numVertices, int & floatsPerVertex, const void *& indices, int & numIndices, int & indexSize) {
+    if(data == NULL || size < (int) sizeof(struct MeshFileHeader))
+        return NULL;
+
+    const struct MeshFileHeader * header = (const struct MeshFileHeader *) data;
+    if(memcmp(header->magic, MESH_FILE_MAGIC, 4) != 0) {
+        LOGE("Not a mesh file");
+        return NULL;
+    }
+    if(header->version != MESH_FILE_VERSION) {
+        LOGE("Mesh file version %d, expected %d", (int) header->version, MESH_FILE_VERSION);
+        return NULL;
+    }
+    size_t vertexBytes = (size_t) header->numVertices * header->floatsPerVertex * sizeof(float);
+    size_t indexBytes = (size_t) header->numIndices * header->indexSize;
+    if((header->indexSize != 2 && header->indexSize != 4) || sizeof(struct MeshFileHeader) + vertexBytes + indexBytes > (size_t) size) {
+        LOGE("Mesh file truncated");
+        return NULL;
+    }
+
+    numVertices = header->numVertices;
+    floatsPerVertex = header->floatsPerVertex;
+    numIndices = header->numIndices;
+    indexSize = header->indexSize;
+    const float * vertexBuffer = (const float *) (header + 1);
+    indices = (const char *) vertexBuffer + vertexBytes;
+    return vertexBuffer;
+}
@@ -0,0 +1,40 @@
+// mesh_format.h
+// nativeGraphics
+// Versioned binary mesh files, precompiled offline from obj files by meshconvert
+
+#ifndef __nativeGraphics__mesh_format__
+#define __nativeGraphics__mesh_format__
+
+#include <stdint.h>
+#include <string>
+
+// Bump MESH_FILE_VERSION whenever the layout below changes; stale files are
+// then rejected and RenderObject falls back to parsing the obj file.
+#define MESH_FILE_MAGIC "NGMB"
+#define MESH_FILE_VERSION 2
+
+// The header is followed directly by numVertices * floatsPerVertex floats,
+// interleaved as returned by getIndexedBuffer, and then by numIndices
+// triangle indices of indexSize (2 or 4) bytes each.
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t floatsPerVertex;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t indexSize;
+};
+
+// Name of the precompiled mesh for an obj resource ("cube.obj" -> "cube_mesh.bin").
+std::string meshFileName(const char * objFilename);
+
+// Writes an indexed vertex buffer to a mesh file, storing 16-bit indices
+// whenever there are few enough vertices. Returns false on failure.
+bool writeMeshFile(const char * path, const float * vertexBuffer, int numVertices, int floatsPerVertex, const unsigned int * indices, int numIndices);
+
+// Validates a (possibly memory-mapped) mesh file and returns a pointer to its
+// vertex data inside the file, or NULL if the file is invalid or out of date.
+// indices is set to point at the index data, also inside the file.
+const float * readMeshFile(const void * data, int size, int & numVertices, int & floatsPerVertex, const void *& indices, int & numIndices, int & indexSize);
+
+#endif // __nativeGraphics__mesh_format__
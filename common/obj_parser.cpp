@@ -5,16 +5,37 @@
 //
 
 #include "obj_parser.h"
-void getObjectData(char * objString, int & numVertices, std::vector<struct Vertex> & vertices, std::vector<struct face> &faces, bool normalCoords, bool textureCoords)
+
+#include "obj_scanner.h"
+#include "ThreadPool.h"
+
+void getObjectData(char * objString, int & numVertices, std::vector<struct Vertex> & vertices, std::vector<struct face> &faces, struct AdjacencyLists & adjacency, bool normalCoords, bool textureCoords)
 {
     // Parse obj file into vertices and faces
 	parseObjString(objString, vertices, faces);
     
     // Compute adjacent vertices and normals
-	computeAdjacencyLists(vertices, faces);
+	computeAdjacencyLists(vertices, faces, adjacency);
 	computeNormals(vertices, faces);
 }
 
+static inline void writeVertex(float * buffer, int & bufferIndex, const struct Vertex & vertex, bool normalCoords, bool textureCoords) {
+	buffer[bufferIndex++] = vertex.coord.x;
+	buffer[bufferIndex++] = vertex.coord.y;
+	buffer[bufferIndex++] = vertex.coord.z;
+    
+    if(normalCoords) {
+	    buffer[bufferIndex++] = vertex.normal.x;
+	    buffer[bufferIndex++] = vertex.normal.y;
+	    buffer[bufferIndex++] = vertex.normal.z;
+	}
+    
+    if(textureCoords) {
+        buffer[bufferIndex++] = vertex.texture[0];
+	    buffer[bufferIndex++] = vertex.texture[1];
+	}
+}
+
 float * getInterleavedBuffer(char * objString, int & numVertices, bool normalCoords, bool textureCoords) {
     
     // Parse obj file into vertices and faces
@@ -22,8 +43,7 @@ float * getInterleavedBuffer(char * objString, int & numVertices, bool normalCoo
 	std::vector<struct face> faces;
 	parseObjString(objString, vertices, faces);
     
-    // Compute adjacent vertices and normals
-	computeAdjacencyLists(vertices, faces);
+    // Compute normals (no adjacency needed)
 	computeNormals(vertices, faces);
     
     const int floatsPerVertex = 3 + (normalCoords ? 3 : 0) + (textureCoords ? 2 : 0);
@@ -39,22 +59,7 @@ float * getInterleavedBuffer(char * objString, int & numVertices, bool normalCoo
 				LOGE("vertexIndex %d out of bounds (0, %d)", vertexIndex, (int) vertices.size());
 		    }
 			
-			struct Vertex * thisVertex = &vertices[vertexIndex];
-            
-			interleavedBuffer[bufferIndex++] = thisVertex->coord.x;
-			interleavedBuffer[bufferIndex++] = thisVertex->coord.y;
-			interleavedBuffer[bufferIndex++] = thisVertex->coord.z;
-            
-            if(normalCoords) {
-			    interleavedBuffer[bufferIndex++] = thisVertex->normal.x;
-			    interleavedBuffer[bufferIndex++] = thisVertex->normal.y;
-			    interleavedBuffer[bufferIndex++] = thisVertex->normal.z;
-			}
-            
-            if(textureCoords) {
-                interleavedBuffer[bufferIndex++] = thisVertex->texture[0];
-			    interleavedBuffer[bufferIndex++] = thisVertex->texture[1];
-			}
+			writeVertex(interleavedBuffer, bufferIndex, vertices[vertexIndex], normalCoords, textureCoords);
 		}
 	}
 	
@@ -62,54 +67,220 @@ float * getInterleavedBuffer(char * objString, int & numVertices, bool normalCoo
     
 }
 
-static bool checkAdjacency(struct face * a, struct face * b) {
-	int sharedVertices = 0;
-	for(int i=0; i<3; i++) {
-		for(int j=0; j<3; j++) {
-			if(a->vertex[i] == b->vertex[j])
-				sharedVertices++;
-		}
+// Like getInterleavedBuffer, but every vertex is written once and the triangles
+// are returned as a list of indices into the vertex buffer. Triangles are
+// ordered for the post-transform vertex cache, and vertices by first use.
+float * getIndexedBuffer(char * objString, int & numVertices, unsigned int *& indices, int & numIndices, bool normalCoords, bool textureCoords) {
+    
+    // Parse obj file into vertices and faces
+    std::vector<struct Vertex> vertices;
+	std::vector<struct face> faces;
+	parseObjString(objString, vertices, faces);
+	computeNormals(vertices, faces);
+    
+    numIndices = faces.size()*3;
+    indices = (unsigned int *) malloc(numIndices * sizeof(unsigned int));
+    for(int i = 0; i < faces.size(); i++)
+		for(int v = 0; v < 3; v++)
+			indices[i*3 + v] = faces[i].vertex[v];
+    
+    optimizeVertexCache(indices, numIndices, vertices.size());
+    
+    // Renumber vertices in order of first use, dropping unreferenced ones.
+    std::vector<int> remap(vertices.size(), -1);
+    numVertices = 0;
+    for(int i = 0; i < numIndices; i++) {
+		if(remap[indices[i]] == -1)
+			remap[indices[i]] = numVertices++;
+		indices[i] = remap[indices[i]];
+	}
+    
+    const int floatsPerVertex = 3 + (normalCoords ? 3 : 0) + (textureCoords ? 2 : 0);
+    float * vertexBuffer = (float *) malloc(numVertices * floatsPerVertex * sizeof(float));
+    for(int i = 0; i < vertices.size(); i++) {
+		if(remap[i] == -1)
+			continue;
+		int bufferIndex = remap[i] * floatsPerVertex;
+		writeVertex(vertexBuffer, bufferIndex, vertices[i], normalCoords, textureCoords);
 	}
-	return sharedVertices == 2;
+    
+    return vertexBuffer;
 }
 
-static void computeAdjacencyLists(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces) {
-	// Clear adjacency lists
-	for(int i = 0; i < vertices.size(); i++)
-		vertices[i].adjacentFaces.clear();
-	for(int i = 0; i < faces.size(); i++)
-		for(int j=0; j<3; j++)
-			faces[i].adjacentFace[j] = -1;
+// Vertex cache optimization after Tom Forsyth, "Linear-Speed Vertex Cache
+// Optimisation" (2006). Vertices are scored by their position in a simulated
+// LRU cache and by how few triangles still use them; the best-scoring
+// triangle touching the cache is emitted next.
+#define VERTEX_CACHE_SIZE 32
+
+static float vertexCacheScore(int cachePosition, int remainingTriangles) {
+	if(remainingTriangles == 0)
+		return -1.0f;
     
-	// Populate each vertex with its adjacent faces.
-	for(int i = 0; i < faces.size(); i++) {
-		struct face * thisFace = &faces[i];
-		for(int j=0; j<3; j++) {
-			int thisIndex = thisFace->vertex[j];
-			struct Vertex * thisVertex = &vertices[thisIndex];
-			if(thisVertex->isAdjacent(i))
-				continue;
-			thisVertex->adjacentFaces.push_back(i);
+	float score = 0.0f;
+	if(cachePosition >= 3)
+		score = powf(1.0f - (cachePosition - 3) / (float) (VERTEX_CACHE_SIZE - 3), 1.5f);
+	else if(cachePosition >= 0)
+		score = 0.75f; // The last triangle's vertices are deliberately not preferred
+    
+	return score + 2.0f / sqrtf((float) remainingTriangles);
+}
+
+void optimizeVertexCache(unsigned int * indices, int numIndices, int numVertices) {
+	const int numTriangles = numIndices / 3;
+	if(numTriangles == 0)
+		return;
+    
+	// Triangles using each vertex, as in computeAdjacencyLists. The first
+	// remaining[v] entries of each row are the triangles not yet emitted.
+	std::vector<int> offsets(numVertices + 1, 0);
+	for(int i = 0; i < numIndices; i++)
+		offsets[indices[i] + 1]++;
+	for(int v = 0; v < numVertices; v++)
+		offsets[v + 1] += offsets[v];
+	std::vector<int> remaining(numVertices);
+	for(int v = 0; v < numVertices; v++)
+		remaining[v] = offsets[v + 1] - offsets[v];
+	std::vector<int> vertexTriangles(numIndices);
+	std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+	for(int i = 0; i < numIndices; i++)
+		vertexTriangles[cursor[indices[i]]++] = i / 3;
+    
+	std::vector<int> cachePosition(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for(int v = 0; v < numVertices; v++)
+		vertexScores[v] = vertexCacheScore(-1, remaining[v]);
+    
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<bool> emitted(numTriangles, false);
+	int bestTriangle = 0;
+	for(int t = 0; t < numTriangles; t++) {
+		triangleScores[t] = vertexScores[indices[t*3]] + vertexScores[indices[t*3+1]] + vertexScores[indices[t*3+2]];
+		if(triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = t;
+	}
+    
+	std::vector<unsigned int> output(numIndices);
+	int cache[VERTEX_CACHE_SIZE + 3];
+	int cacheSize = 0;
+	int scanCursor = 0;
+    
+	for(int n = 0; n < numTriangles; n++) {
+		if(bestTriangle < 0) {
+			// Nothing in the cache is still useful; start over anywhere.
+			while(emitted[scanCursor])
+				scanCursor++;
+			bestTriangle = scanCursor;
+		}
+        
+		const unsigned int * triangle = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+		for(int j = 0; j < 3; j++) {
+			output[n*3 + j] = triangle[j];
+            
+			// Drop the triangle from this vertex's remaining list
+			int v = triangle[j];
+			int * row = &vertexTriangles[offsets[v]];
+			for(int k = 0; k < remaining[v]; k++) {
+				if(row[k] == bestTriangle) {
+					row[k] = row[--remaining[v]];
+					break;
+				}
+			}
+		}
+        
+		// Move the triangle's vertices to the front of the LRU cache
+		int newCache[VERTEX_CACHE_SIZE + 3];
+		int newCacheSize = 0;
+		for(int j = 0; j < 3; j++)
+			if(j == 0 || (triangle[j] != triangle[0] && (j == 1 || triangle[j] != triangle[1])))
+				newCache[newCacheSize++] = triangle[j];
+		for(int k = 0; k < cacheSize; k++) {
+			int v = cache[k];
+			if(v != (int) triangle[0] && v != (int) triangle[1] && v != (int) triangle[2])
+				newCache[newCacheSize++] = v;
+		}
+        
+		for(int k = 0; k < newCacheSize; k++) {
+			int v = newCache[k];
+			cachePosition[v] = k < VERTEX_CACHE_SIZE ? k : -1;
+			vertexScores[v] = vertexCacheScore(cachePosition[v], remaining[v]);
+		}
+		cacheSize = newCacheSize < VERTEX_CACHE_SIZE ? newCacheSize : VERTEX_CACHE_SIZE;
+		for(int k = 0; k < cacheSize; k++)
+			cache[k] = newCache[k];
+        
+		// Rescore the triangles touching the cache and pick the best one
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for(int k = 0; k < cacheSize; k++) {
+			int v = cache[k];
+			for(int r = offsets[v]; r < offsets[v] + remaining[v]; r++) {
+				int t = vertexTriangles[r];
+				triangleScores[t] = vertexScores[indices[t*3]] + vertexScores[indices[t*3+1]] + vertexScores[indices[t*3+2]];
+				if(triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
 		}
 	}
+    
+	memcpy(indices, &output[0], numIndices * sizeof(unsigned int));
+}
+
+// True if vertex index v appears in face before position j (degenerate faces).
+static inline bool repeatsVertex(const struct face & f, int j) {
+	for(int k = 0; k < j; k++)
+		if(f.vertex[k] == f.vertex[j])
+			return true;
+	return false;
+}
+
+static inline bool hasVertex(const struct face & f, int v) {
+	return f.vertex[0] == v || f.vertex[1] == v || f.vertex[2] == v;
+}
+
+static void computeAdjacencyLists(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces, struct AdjacencyLists & adjacency) {
+	// Count the faces touching each vertex, then prefix-sum into row offsets.
+	adjacency.offsets.assign(vertices.size() + 1, 0);
+	for(int i = 0; i < faces.size(); i++)
+		for(int j = 0; j < 3; j++)
+			if(!repeatsVertex(faces[i], j))
+				adjacency.offsets[faces[i].vertex[j] + 1]++;
+	for(int v = 0; v < vertices.size(); v++)
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+    
+	// Populate each vertex with its adjacent faces, in face order.
+	adjacency.faces.resize(adjacency.offsets[vertices.size()]);
+	std::vector<int> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for(int i = 0; i < faces.size(); i++)
+		for(int j = 0; j < 3; j++)
+			if(!repeatsVertex(faces[i], j))
+				adjacency.faces[cursor[faces[i].vertex[j]]++] = i;
 	
-	// Populate each face with its adjacent faces.
-	for(int i=0; i < faces.size(); i++) {
+	// Populate each face with its adjacent faces. The face across edge (a, b)
+	// must touch a, so only the short list around a needs to be searched.
+	for(int i = 0; i < faces.size(); i++) {
 		struct face * thisFace = &faces[i];
-		for(int j=0; j<3; j++) {
-			int thisIndex = thisFace->vertex[j];
-			struct Vertex * thisVertex = &vertices[thisIndex];
-			for(int k=0; k<thisVertex->adjacentFaces.size(); k++) {
-				struct face * possibleAdjacentFace = &faces[thisVertex->adjacentFaces[k]];
-				if(checkAdjacency(thisFace, possibleAdjacentFace))
-					thisFace->adjacentFace[j] = thisVertex->adjacentFaces[k];
+		for(int j = 0; j < 3; j++) {
+			int a = thisFace->vertex[j];
+			int b = thisFace->vertex[(j + 1) % 3];
+			thisFace->adjacentFace[j] = -1;
+			for(int k = adjacency.offsets[a]; k < adjacency.offsets[a + 1]; k++) {
+				int other = adjacency.faces[k];
+				if(other != i && hasVertex(faces[other], b))
+					thisFace->adjacentFace[j] = other;
 			}
 		}
 	}
 }
 
 static void computeNormals(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces) {
-	// Calculate normals per-face
+	for(int i = 0; i < vertices.size(); i++)
+		vertices[i].normal = Point3();
+    
+	// Calculate normals per-face and accumulate them onto their vertices
 	for(int i = 0; i < faces.size(); i++) {
 		struct face * thisFace = &faces[i];
 		Point3 vertex0 = vertices[thisFace->vertex[0]].coord;
@@ -118,130 +289,159 @@ static void computeNormals(std::vector<struct Vertex> & vertices, std::vector<st
 		Vector3 normal = Vector3::Cross(vertex1 - vertex0, vertex2 - vertex0);
 		normal.Normalize();
 		thisFace->normal = Point3(normal);
+		for(int j = 0; j < 3; j++) {
+			if(repeatsVertex(*thisFace, j))
+				continue;
+			Point3 * vertexNormal = &vertices[thisFace->vertex[j]].normal;
+			vertexNormal->x += normal.x;
+			vertexNormal->y += normal.y;
+			vertexNormal->z += normal.z;
+		}
 	}
 	// Average faces for per-vertex normals
 	for(int i = 0; i < vertices.size(); i++) {
 		struct Vertex * thisVertex = &vertices[i];
-		Vector3 totalNormal = Vector3();
-		for(int j = 0; j < thisVertex->adjacentFaces.size(); j++) {
-			struct face * thisFace = &faces[thisVertex->adjacentFaces[j]];
-			totalNormal.x += thisFace->normal.x;
-			totalNormal.y += thisFace->normal.y;
-			totalNormal.z += thisFace->normal.z;
-		}
+		Vector3 totalNormal = Vector3(thisVertex->normal.x, thisVertex->normal.y, thisVertex->normal.z);
 		totalNormal.Normalize();
 		thisVertex->normal = Point3(totalNormal);
 	}
 }
 
-static void parseObjLine(char * line, std::vector<struct Vertex> & vertices, std::vector<struct Texture> & textures, std::vector<struct face> & faces) {
-	char * saveptr;
-	char * tok = strtok_r(line, " ", &saveptr);
-	if(tok == NULL || tok[0] == '#')
+// Parses "v", "v/vt" or "v/vt/vn" (any part may be omitted after v). Negative
+// indices count back from the current vertex / texture coordinate.
+static bool scanFaceVertex(const char *& p, const char * end, int & vertex, int & texture) {
+	if(!scanInt(p, end, vertex))
+		return false;
+	texture = 0;
+	if(p < end && *p == '/') {
+		p++;
+		scanInt(p, end, texture);
+	}
+	p = skipToken(p, end);
+	return true;
+}
+
+// Everything parsed from one newline-aligned piece of an obj file. Indices
+// are stored as in the full file, except that relative (negative) ones are
+// resolved against this chunk's counts and flagged in relativeIndices
+// (bits 0-2 vertices, 3-5 textures) so the merge can offset them.
+struct ObjChunk {
+	const char * begin;
+	const char * end;
+	std::vector<struct Vertex> vertices;
+	std::vector<struct Texture> textures;
+	std::vector<struct face> faces;
+	std::vector<unsigned char> relativeIndices;
+};
+
+static void parseObjLine(const char * line, const char * end, struct ObjChunk * chunk) {
+	const char * p = skipBlanks(line, end);
+	if(p == end || *p == '#' || *p == '\n')
 		return;
     
 	// Parse a vertex
-	if(strcmp(tok, "v") == 0) {
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		float x = atof(tok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		float y = atof(tok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
+	if(scanKeyword(p, end, "v")) {
+		float coord[3];
+		for(int i = 0; i < 3; i++) {
+			p = skipBlanks(p, end);
+			if(!scanFloat(p, end, coord[i])) {
+				LOGE("Error in ParseObjLine");
+				return;
+			}
 		}
-		float z = atof(tok);
-        
-		vertices.push_back(Vertex(x, y, z));
+		chunk->vertices.push_back(Vertex(coord[0], coord[1], coord[2]));
 	}
     
-	if(strcmp(tok, "vt") == 0) {
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		float u = atof(tok);
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
+	else if(scanKeyword(p, end, "vt")) {
+		float coord[2];
+		for(int i = 0; i < 2; i++) {
+			p = skipBlanks(p, end);
+			if(!scanFloat(p, end, coord[i])) {
+				LOGE("Error in ParseObjLine");
+				return;
+			}
 		}
-		float v = atof(tok);
-        
-		textures.push_back(Texture(u, v));
+		chunk->textures.push_back(Texture(coord[0], coord[1]));
 	}
     
 	// Parse a face
-	if(strcmp(tok, "f") == 0) {
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		int v1 = atoi(tok) - 1; // Zero index
-        
-		char*texsaveptr;
-		int texIndex[3] = {-1,-1,-1};
-		strtok_r(tok, "/", &texsaveptr);
-		char * textok = strtok_r(NULL, "/", &texsaveptr);
-		if(textok != NULL)
-			texIndex[0] = atoi(textok) - 1;
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
-		}
-		int v2 = atoi(tok) - 1;
-        
-		strtok_r(tok, "/", &texsaveptr);
-		textok = strtok_r(NULL, "/", &texsaveptr);
-		if(textok != NULL)
-			texIndex[1] = atoi(textok) - 1;
-        
-		tok = strtok_r(NULL, " ", &saveptr);
-		if(tok == NULL || tok[0] == '#') {
-			LOGE("Error in ParseObjLine");
-			return;
+	else if(scanKeyword(p, end, "f")) {
+		int vertex[3], texture[3];
+		unsigned char relative = 0;
+		for(int i = 0; i < 3; i++) {
+			p = skipBlanks(p, end);
+			if(!scanFaceVertex(p, end, vertex[i], texture[i])) {
+				LOGE("Error in ParseObjLine");
+				return;
+			}
+			// Zero index
+			if(vertex[i] < 0) {
+				vertex[i] += chunk->vertices.size();
+				relative |= 1 << i;
+			} else {
+				vertex[i] -= 1;
+			}
+			if(texture[i] < 0) {
+				texture[i] += chunk->textures.size();
+				relative |= 8 << i;
+			} else {
+				texture[i] -= 1; // -1 if there is no texture coordinate
+			}
 		}
-		int v3 = atoi(tok) - 1;
         
-		strtok_r(tok, "/", &texsaveptr);
-		textok = strtok_r(NULL, "/", &texsaveptr);
-		if(textok != NULL)
-			texIndex[2] = atoi(textok) - 1;
-        
-		struct face thisFace = face(v1, v2, v3);
-		thisFace.texture[0] = texIndex[0];
-		thisFace.texture[1] = texIndex[1];
-		thisFace.texture[2] = texIndex[2];
-		faces.push_back(thisFace);
+		struct face thisFace = face(vertex[0], vertex[1], vertex[2]);
+		thisFace.texture[0] = texture[0];
+		thisFace.texture[1] = texture[1];
+		thisFace.texture[2] = texture[2];
+		chunk->faces.push_back(thisFace);
+		chunk->relativeIndices.push_back(relative);
 	}
 }
 
+static void parseObjChunk(void * arg) {
+	struct ObjChunk * chunk = (struct ObjChunk *) arg;
+	for(const char * line = chunk->begin; line < chunk->end; line = nextLine(line, chunk->end))
+		parseObjLine(line, chunk->end, chunk);
+}
+
+#define OBJ_MIN_CHUNK_SIZE 65536
+
 static void parseObjString(char * objString, std::vector<struct Vertex> & vertices, std::vector<struct face> & faces) {
     
 	std::vector<struct Texture> textures;
     
-	char * saveptr;
-	char * line = strtok_r(objString, "\n", &saveptr);
-	while(line != NULL) {
-		parseObjLine(line, vertices, textures, faces);
-		line = strtok_r(NULL, "\n", &saveptr);
+	// Parse newline-aligned chunks of the file in parallel
+	ThreadPool * pool = ThreadPool::Shared();
+	std::vector<const char *> boundaries = splitLines(objString, objString + strlen(objString), 4 * (pool->NumThreads() + 1), OBJ_MIN_CHUNK_SIZE);
+	int numChunks = boundaries.size() - 1;
+	std::vector<struct ObjChunk> chunks(numChunks);
+	std::vector<void *> chunkArgs(numChunks);
+	for(int c = 0; c < numChunks; c++) {
+		chunks[c].begin = boundaries[c];
+		chunks[c].end = boundaries[c + 1];
+		chunkArgs[c] = &chunks[c];
+	}
+	pool->Run(parseObjChunk, numChunks ? &chunkArgs[0] : NULL, numChunks);
+    
+	// Concatenate the chunks, offsetting relative indices
+	for(int c = 0; c < numChunks; c++) {
+		struct ObjChunk * chunk = &chunks[c];
+		int vertexOffset = vertices.size();
+		int textureOffset = textures.size();
+		for(int i = 0; i < chunk->faces.size(); i++) {
+			unsigned char relative = chunk->relativeIndices[i];
+			for(int v = 0; relative && v < 3; v++) {
+				if(relative & (1 << v))
+					chunk->faces[i].vertex[v] += vertexOffset;
+				if(relative & (8 << v))
+					chunk->faces[i].texture[v] += textureOffset;
+			}
+		}
+		vertices.insert(vertices.end(), chunk->vertices.begin(), chunk->vertices.end());
+		textures.insert(textures.end(), chunk->textures.begin(), chunk->textures.end());
+		faces.insert(faces.end(), chunk->faces.begin(), chunk->faces.end());
 	}
+    
 	// Copy textures into vertex structs.
 	for(int i = 0; i < faces.size(); i++) {
 		for(int v = 0; v < 3; v++) {
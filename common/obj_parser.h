@@ -17,10 +17,12 @@
 // Public Interface: -----------------------------------------------------------
 
 float * getInterleavedBuffer(char * objString, int & numVertices, bool normalCoords = false, bool textureCoords = false);
-void getObjectData(char * objString, int & numVertices, std::vector<struct Vertex> & vertices, std::vector<struct face> &faces, bool normalCoords = false, bool textureCoords = false);
+float * getIndexedBuffer(char * objString, int & numVertices, unsigned int *& indices, int & numIndices, bool normalCoords = false, bool textureCoords = false);
+void optimizeVertexCache(unsigned int * indices, int numIndices, int numVertices);
+void getObjectData(char * objString, int & numVertices, std::vector<struct Vertex> & vertices, std::vector<struct face> &faces, struct AdjacencyLists & adjacency, bool normalCoords = false, bool textureCoords = false);
 
 static void parseObjString(char * objString, std::vector<struct Vertex> & vertices, std::vector<struct face> & faces);
-static void computeAdjacencyLists(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces);
+static void computeAdjacencyLists(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces, struct AdjacencyLists & adjacency);
 static void subdivideMesh(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces);
 static void smoothMesh(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces);
 static void computeNormals(std::vector<struct Vertex> & vertices, std::vector<struct face> & faces);
@@ -36,15 +38,7 @@ struct Vertex {
 	Point3 coord;
 	float texture[2];
 	Point3 normal;
-	std::vector<int> adjacentFaces;
 	bool odd;
-
-	bool isAdjacent(int face) {
-		for(int i = 0; i<adjacentFaces.size(); i++)
-			if(adjacentFaces[i] == face)
-				return true;
-		return false;
-	}
 };
 
 struct Texture {
@@ -66,9 +60,16 @@ struct face {
 	}
 	int vertex[3];
 	int texture[3];
-	int adjacentFace[3];
+	int adjacentFace[3]; // Face across the edge vertex[i] -> vertex[(i+1)%3], or -1
 	Point3 normal;
 };
 
+// Faces adjacent to each vertex, stored flat (compressed sparse row).
+// The faces touching vertex v are faces[offsets[v]] .. faces[offsets[v+1]-1].
+struct AdjacencyLists {
+	std::vector<int> offsets;
+	std::vector<int> faces;
+};
+
 
 #endif // __nativeGraphics__obj_parser__
@@ -0,0 +1,140 @@
+// obj_scanner.h
+// nativeGraphics
+// Allocation-free number scanning and line chunking shared by the obj parsers
+
+#ifndef __nativeGraphics__obj_scanner__
+#define __nativeGraphics__obj_scanner__
+
+#include <stdint.h>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Each scan function reads one token starting at p (which must not point past
+// end), advances p past it and returns true, or leaves p alone and returns
+// false if there is no such token. None of them cross a newline.
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char * skipBlanks(const char * p, const char * end) {
+    while(p < end && isBlank(*p))
+        p++;
+    return p;
+}
+
+static inline const char * skipToken(const char * p, const char * end) {
+    while(p < end && !isBlank(*p) && *p != '\n')
+        p++;
+    return p;
+}
+
+// Start of the line following the one p is in.
+static inline const char * nextLine(const char * p, const char * end) {
+    const char * newline = (const char *) memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+// True if the line at p starts with the given keyword, followed by a blank.
+static inline bool scanKeyword(const char *& p, const char * end, const char * keyword) {
+    int length = strlen(keyword);
+    if(end - p <= length || memcmp(p, keyword, length) != 0 || !isBlank(p[length]))
+        return false;
+    p += length;
+    return true;
+}
+
+static inline bool scanInt(const char *& p, const char * end, int & value) {
+    const char * s = p;
+    bool negative = false;
+    if(s < end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+    if(s == end || *s < '0' || *s > '9')
+        return false;
+
+    int result = 0;
+    while(s < end && *s >= '0' && *s <= '9')
+        result = result * 10 + (*s++ - '0');
+
+    value = negative ? -result : result;
+    p = s;
+    return true;
+}
+
+// Decimal float with optional fraction and exponent. Up to 18 significant
+// digits are kept exactly, then scaled by a single power-of-ten operation.
+static inline bool scanFloat(const char *& p, const char * end, float & value) {
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char * s = p;
+    bool negative = false;
+    if(s < end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for(; s < end && *s >= '0' && *s <= '9'; s++, digits++) {
+        if(mantissa < 100000000000000000ULL)
+            mantissa = mantissa * 10 + (*s - '0');
+        else
+            exponent++;
+    }
+    if(s < end && *s == '.') {
+        for(s++; s < end && *s >= '0' && *s <= '9'; s++, digits++) {
+            if(mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (*s - '0');
+                exponent--;
+            }
+        }
+    }
+    if(digits == 0)
+        return false;
+
+    if(s < end && (*s == 'e' || *s == 'E')) {
+        const char * e = s + 1;
+        int exponentPart;
+        if(scanInt(e, end, exponentPart)) {
+            exponent += exponentPart;
+            s = e;
+        }
+    }
+
+    double result = (double) mantissa;
+    if(exponent < 0)
+        result /= -exponent <= 22 ? powersOf10[-exponent] : pow(10.0, -exponent);
+    else if(exponent > 0)
+        result *= exponent <= 22 ? powersOf10[exponent] : pow(10.0, exponent);
+
+    value = (float) (negative ? -result : result);
+    p = s;
+    return true;
+}
+
+// Splits text into at most maxChunks pieces of at least minChunkSize bytes,
+// each ending just after a newline (or at end). Returns the chunk boundaries:
+// chunk i runs from boundaries[i] to boundaries[i+1].
+static inline std::vector<const char *> splitLines(const char * text, const char * end, int maxChunks, int minChunkSize) {
+    std::vector<const char *> boundaries;
+    boundaries.push_back(text);
+
+    size_t chunkSize = (end - text) / (maxChunks > 0 ? maxChunks : 1) + 1;
+    if(chunkSize < (size_t) minChunkSize)
+        chunkSize = minChunkSize;
+
+    const char * p = text;
+    while(end - p > (ptrdiff_t) chunkSize) {
+        p = nextLine(p + chunkSize, end);
+        boundaries.push_back(p);
+    }
+    if(boundaries.back() != end)
+        boundaries.push_back(end);
+    return boundaries;
+}
+
+#endif // __nativeGraphics__obj_scanner__
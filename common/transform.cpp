@@ -4,23 +4,97 @@
 
 #include "Eigen/LU"
 
-std::stack<Matrix4f> model_view;
-std::stack<Matrix4f> projection;
+#include "log.h"
+
+MatrixStack model_view;
+MatrixStack projection;
+TransformCache transforms;
 
 #define _USE_MATH_DEFINES // M_PI
 
+MatrixStack::MatrixStack() {
+    depth = 0;
+    changes = 0;
+    stack[0] = Matrix4f::Identity();
+}
+
+void MatrixStack::push() {
+    if(depth + 1 >= MATRIX_STACK_DEPTH) {
+        LOGE("MatrixStack::push: Stack overflow.");
+        return;
+    }
+    stack[depth + 1] = stack[depth];
+    depth++;
+}
+
+void MatrixStack::pop() {
+    if(depth == 0) {
+        LOGE("MatrixStack::pop: Stack underflow.");
+        return;
+    }
+    depth--;
+    changes++;
+}
+
+void MatrixStack::load(const Matrix4f & m) {
+    stack[depth] = m;
+    changes++;
+}
+
+void MatrixStack::multiply(const Matrix4f & m) {
+    stack[depth] *= m;
+    changes++;
+}
+
+void MatrixStack::clear() {
+    depth = 0;
+    load(Matrix4f::Identity());
+}
+
+TransformCache::TransformCache() {
+    pInverseVersion = -1;
+    mvpVersions[0] = mvpVersions[1] = -1;
+    mvpInverseVersions[0] = mvpInverseVersions[1] = -1;
+}
+
+// True (and records the current versions) if the stacks changed since
+// versions were recorded.
+static bool stale(unsigned int versions[2]) {
+    if(versions[0] == model_view.version() && versions[1] == projection.version())
+        return false;
+    versions[0] = model_view.version();
+    versions[1] = projection.version();
+    return true;
+}
+
+const Matrix4f & TransformCache::pInverse() {
+    if(pInverseVersion != projection.version()) {
+        pInverseValue = projection.top().inverse();
+        pInverseVersion = projection.version();
+    }
+    return pInverseValue;
+}
+
+const Matrix4f & TransformCache::mvp() {
+    if(stale(mvpVersions))
+        mvpValue = projection.top() * model_view.top();
+    return mvpValue;
+}
+
+const Matrix4f & TransformCache::mvpInverse() {
+    if(stale(mvpInverseVersions))
+        mvpInverseValue = mvp().inverse();
+    return mvpInverseValue;
+}
+
 //Model-view
 //get the current matrix
-float* mvMatrix(){
-    float* mvMatrix = new float[16];
-    for(int i=0; i<4; i++)
-        for(int j=0; j<4; j++)
-            mvMatrix[i*4+j] = model_view.top()(j,i);
-    return mvMatrix;
+const float* mvMatrix(){
+    return model_view.top().data();
 }
 //Push
 void mvPushMatrix(){
-    model_view.push(model_view.top());
+    model_view.push();
 }
 //Pop
 void mvPopMatrix(){
@@ -28,7 +102,7 @@ void mvPopMatrix(){
 }
 //Load Identity
 void mvLoadIdentity(){
-    model_view.push(Matrix4f::Identity());
+    model_view.load(Matrix4f::Identity());
 }
 //Scale
 void scalef(float s) {
@@ -37,7 +111,7 @@ void scalef(float s) {
 void scalef(float sx, float sy, float sz){
     Matrix4f scale;
     scale<<sx,0,0,0,0,sy,0,0,0,0,sz,0,0,0,0,1;
-    model_view.top() *= scale;
+    model_view.multiply(scale);
 }
 //Translate
 void translate(Eigen::Vector3f translation){
@@ -46,7 +120,7 @@ void translate(Eigen::Vector3f translation){
 void translatef(float x, float y, float z){
     Matrix4f translation;
     translation<<1.f,0.f,0.f,x,0.f,1.f,0.f,y,0.f,0.f,1.f,z,0.f,0.f,0.f,1.f;
-    model_view.top() *= translation;
+    model_view.multiply(translation);
 }
 //Rotate, angle in degrees
 void rotatef(float angle, float x, float y, float z){
@@ -65,7 +139,7 @@ void rotatef(float angle, float x, float y, float z){
     u_xy+u_z,cos_theta+u_yy,u_yz-u_x,0.f,
     u_xz-u_y,u_yz+u_x,cos_theta+u_zz,0.f,
     0.f,0.f,0.f,1.f;
-    model_view.top() *= rotation;
+    model_view.multiply(rotation);
     
 }
 //rotate
@@ -88,7 +162,7 @@ void rotate(float rx, float ry, float rz){
     rotz(0,0) = cosrz; rotz(0,1) = -sinrz;
     rotz(1,0) = sinrz; rotz(1,1) = cosrz;
     
-    model_view.top() *= (rotx * roty * rotz);
+    model_view.multiply(rotx * roty * rotz);
 }
 //Scale
 
@@ -154,30 +228,21 @@ void lookAt(float eyex, float eyey, float eyez,
     M<<x[0],x[1],x[2],0.f,y[0],y[1],y[2],0.f,z[0],z[1],z[2],0.f,
     0.f,0.f,0.f,1.f;
     
-    model_view.top() *= M;
+    model_view.multiply(M);
     translatef(-eyex,-eyey,-eyez);
 }
 //projection
-float* pMatrix(){
-    float* pMatrix = new float[16];
-    for(int i=0; i<4; i++)
-        for(int j=0; j<4; j++)
-            pMatrix[i*4+j] = projection.top()(j,i);
-    return pMatrix;
+const float* pMatrix(){
+    return projection.top().data();
 }
 
-float* pInverseMatrix(){
-    Matrix4f inverse = projection.top().inverse();
-    float* pMatrix = new float[16];
-    for(int i=0; i<4; i++)
-        for(int j=0; j<4; j++)
-            pMatrix[i*4+j] = inverse(j,i);
-    return pMatrix;
+const float* pInverseMatrix(){
+    return transforms.pInverse().data();
 }
 
 //Push
 void pPushMatrix(){
-    projection.push(projection.top());
+    projection.push();
 }
 //Pop
 void pPopMatrix(){
@@ -185,7 +250,7 @@ void pPopMatrix(){
 }
 //Load Identity
 void pLoadIdentity(){
-    projection.push(Matrix4f::Identity());
+    projection.load(Matrix4f::Identity());
 }
 //frustum
 void frustum(double left, double right, double bottom, double top,
@@ -197,7 +262,7 @@ void frustum(double left, double right, double bottom, double top,
     0.f,_nearVal/t_b,(top+bottom)/t_b,0.f,
     0.f,0.f,-(farVal+nearVal)/f_n,-farVal*_nearVal/f_n,
     0.f,0.f,-1.f,0.f;
-    projection.top() *= frustum;
+    projection.multiply(frustum);
 }
 //Perspective
 void perspective(float fovy, float aspect,
@@ -219,14 +284,9 @@ void viewport(int x, int y, int width, int height){
     Matrix4f translate;
     translate<<1.f,0.f,0.f,x+width_2,0.f,1.f,0.f,y+height_2,0.f,0.f,1.f,0.5f,
     0.f,0.f,0.f,1.f;
-    projection.top() *= (scale*translate);
+    projection.multiply(scale*translate);
 }
 //return combined mvp matrix
-float* mvpMatrix(){
-    Matrix4f mvp = projection.top()*model_view.top();
-    float* mvpMatrix = new float[16];
-    for(int i=0; i<4; i++)
-        for(int j=0; j<4; j++)
-            mvpMatrix[i*4+j] = mvp(j,i);
-    return mvpMatrix;  
+const float* mvpMatrix(){
+    return transforms.mvp().data();
 }
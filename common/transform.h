@@ -3,16 +3,73 @@
 
 #include <iostream>
 #include "Eigen/Core"
-#include <stack>
 using Eigen::Matrix4f;
 using Eigen::Vector3f;
 
-extern std::stack<Matrix4f> model_view;
-extern std::stack<Matrix4f> projection;
+#define MATRIX_STACK_DEPTH 32
+
+// Fixed-capacity matrix stack. Eigen stores matrices column-major, which is
+// what glUniformMatrix4fv expects, so top().data() can be uploaded as is.
+class MatrixStack {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    MatrixStack();
+
+    const Matrix4f & top() const { return stack[depth]; }
+    int size() const { return depth + 1; }
+
+    void push();
+    void pop();
+    void load(const Matrix4f & m); // Replaces the top
+    void multiply(const Matrix4f & m); // Right-multiplies the top
+    void clear(); // Back to a single identity matrix
+
+    // Changes whenever top() does, so values derived from it can be cached.
+    unsigned int version() const { return changes; }
+
+private:
+    Matrix4f stack[MATRIX_STACK_DEPTH];
+    int depth;
+    unsigned int changes;
+};
+
+extern MatrixStack model_view;
+extern MatrixStack projection;
+
+// Matrices derived from model_view and projection. Each is computed on first
+// use after a stack it depends on changes, then reused until the next change.
+class TransformCache {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    TransformCache();
+
+    const Matrix4f & mv() const { return model_view.top(); }
+    const Matrix4f & p() const { return projection.top(); }
+    const Matrix4f & pInverse();
+    const Matrix4f & mvp();
+    const Matrix4f & mvpInverse();
+
+private:
+    Matrix4f pInverseValue;
+    Matrix4f mvpValue;
+    Matrix4f mvpInverseValue;
+
+    // Stack versions each matrix was computed from
+    unsigned int pInverseVersion;
+    unsigned int mvpVersions[2];
+    unsigned int mvpInverseVersions[2];
+};
+
+extern TransformCache transforms;
+
+// The matrix getters below return column-major storage owned by the stacks
+// (or by a cache), valid until the next change to the transform.
 
 //Model-view
 //get the current matrix
-float* mvMatrix();
+const float* mvMatrix();
 //Push
 void mvPushMatrix();
 //Pop
@@ -38,9 +95,10 @@ void lookAt(float eyex, float eyey, float eyez,
 	              float centerx, float centery, float centerz,
             float upx, float upy, float upz);
 //projection
-float* pMatrix();
+const float* pMatrix();
 
-float* pInverseMatrix();
+// Cached until the projection changes.
+const float* pInverseMatrix();
 
 //Push
 void pPushMatrix();
@@ -55,8 +113,8 @@ void frustum(double left, double right, double bottom, double top,
 void perspective(float fovy, float aspect,
                  float zNear, float zFar);
 void viewport(int x, int y, int width, int height);
-//return combined mvp matrix
-float* mvpMatrix();
+//return combined mvp matrix, cached until either matrix changes
+const float* mvpMatrix();
 
 #endif /* defined(__nativeGraphics__transform__) */
 
@@ -0,0 +1,402 @@
+// benchmark.cpp
+// nativeGraphics
+// Microbenchmarks for the CPU-side engine kernels. Needs no GL library or
+// context, so regressions in the hot loops can be caught on any machine.
+//
+// Usage: NativeGraphicsBenchmark [options]
+//   --reps N          timed repetitions per benchmark (default 20)
+//   --warmup N        untimed repetitions first (default 3)
+//   --filter STR      only run benchmarks whose name contains STR
+//   --json FILE       write results as JSON
+//   --list            print the benchmark names and exit
+//
+// Each repetition is timed on its own. Setup runs untimed before every
+// repetition, so each one starts from the same state.
+
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "log.h"
+#include "Timer.h"
+#include "obj_parser.h"
+#include "transform.h"
+#include "InstanceTransforms.h"
+#include "Fluid.h"
+#include "RenderDestructible.h"
+#include "resource_callbacks.h"
+#include "../cave/simplex/simplexnoise.h"
+
+using namespace std;
+
+#define RESOURCE_DIRECTORY "../res/raw/"
+
+// Results are summed here so the compiler can't drop the work.
+static volatile float sink;
+
+struct Benchmark {
+    string name;
+    void (*setup)(Benchmark * benchmark); // Untimed, before each repetition; may be NULL
+    void (*run)(Benchmark * benchmark);
+    int items; // Units of work per repetition, for the per-item time
+    void * state;
+};
+
+struct BenchmarkResult {
+    string name;
+    int items;
+    vector<double> seconds; // Sorted
+};
+
+// obj parsing -----------------------------------------------------------------
+
+struct ObjState {
+    string source;
+    vector<char> buffer; // Parsing may write into its input, so parse a copy
+};
+
+static void objSetup(Benchmark * benchmark) {
+    ObjState * state = (ObjState *) benchmark->state;
+    state->buffer.assign(state->source.begin(), state->source.end());
+    state->buffer.push_back('\0');
+}
+
+static void objRun(Benchmark * benchmark) {
+    ObjState * state = (ObjState *) benchmark->state;
+    int numVertices;
+    float * vertexBuffer = getInterleavedBuffer(&state->buffer[0], numVertices, true, true);
+    sink += numVertices > 0 ? vertexBuffer[0] : 0.0f;
+    free(vertexBuffer);
+}
+
+// Every obj shipped in res/raw, except subvox.obj which holds destructible
+// voxel data rather than a mesh.
+static void addObjBenchmarks(vector<Benchmark> & benchmarks) {
+    DIR * directory = opendir(RESOURCE_DIRECTORY);
+    if(!directory) {
+        LOGE("Unable to open %s", RESOURCE_DIRECTORY);
+        return;
+    }
+    vector<string> fileNames;
+    while(struct dirent * entry = readdir(directory)) {
+        string fileName = entry->d_name;
+        if(fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".obj") == 0 && fileName != "subvox.obj")
+            fileNames.push_back(fileName);
+    }
+    closedir(directory);
+    sort(fileNames.begin(), fileNames.end());
+
+    for(int i = 0; i < fileNames.size(); i++) {
+        char * source = (char *) loadResource(fileNames[i].c_str());
+        if(!source)
+            continue;
+        ObjState * state = new ObjState;
+        state->source = source;
+        free(source);
+
+        Benchmark benchmark;
+        benchmark.name = "getInterleavedBuffer/" + fileNames[i];
+        benchmark.setup = objSetup;
+        benchmark.run = objRun;
+        benchmark.items = 1;
+        benchmark.state = state;
+        benchmarks.push_back(benchmark);
+    }
+}
+
+// Fluid -----------------------------------------------------------------------
+
+#define FLUID_STEPS 100
+
+static void fluidSetup(Benchmark * benchmark) {
+    delete (Fluid *) benchmark->state;
+    srand(0);
+    benchmark->state = new Fluid();
+}
+
+static void fluidRun(Benchmark * benchmark) {
+    Fluid * fluid = (Fluid *) benchmark->state;
+    for(int i = 0; i < FLUID_STEPS; i++)
+        fluid->Update();
+    sink += fluid->listParticles.size();
+}
+
+// RenderDestructible ----------------------------------------------------------
+
+#define DESTRUCTIBLE_STEPS 20
+
+static void destructibleSetup(Benchmark * benchmark) {
+    delete (RenderDestructible *) benchmark->state;
+    srand(0);
+    benchmark->state = new RenderDestructible();
+}
+
+static void destructibleRun(Benchmark * benchmark) {
+    RenderDestructible * destructible = (RenderDestructible *) benchmark->state;
+    for(int i = 0; i < DESTRUCTIBLE_STEPS; i++) {
+        int numVertices;
+        GLfloat * geometry = destructible->getGeometry(numVertices);
+        sink += numVertices > 0 ? geometry[0] : 0.0f;
+        free(geometry);
+    }
+}
+
+// Marching cubes --------------------------------------------------------------
+
+#define POLYGONISE_GRID 48
+
+// Field values at the grid's corners: a sphere roughened by noise.
+static vector<double> polygoniseField;
+
+static double &fieldAt(int x, int y, int z) {
+    int n = POLYGONISE_GRID + 1;
+    return polygoniseField[(z * n + y) * n + x];
+}
+
+static void polygoniseSetup(Benchmark * benchmark) {
+    if(!polygoniseField.empty())
+        return;
+    int n = POLYGONISE_GRID + 1;
+    polygoniseField.resize(n * n * n);
+    for(int z = 0; z < n; z++)
+        for(int y = 0; y < n; y++)
+            for(int x = 0; x < n; x++) {
+                float px = x / (float) POLYGONISE_GRID - .5f;
+                float py = y / (float) POLYGONISE_GRID - .5f;
+                float pz = z / (float) POLYGONISE_GRID - .5f;
+                fieldAt(x, y, z) = sqrtf(px * px + py * py + pz * pz) + .1f * octave_noise_3d(3, .5f, 4, px, py, pz);
+            }
+}
+
+static void polygoniseRun(Benchmark * benchmark) {
+    static const int corner[8][3] = { {0,0,0}, {1,0,0}, {1,0,1}, {0,0,1}, {0,1,0}, {1,1,0}, {1,1,1}, {0,1,1} };
+    TRIANGLE triangles[5];
+    int numTriangles = 0;
+    for(int z = 0; z < POLYGONISE_GRID; z++)
+        for(int y = 0; y < POLYGONISE_GRID; y++)
+            for(int x = 0; x < POLYGONISE_GRID; x++) {
+                GRIDCELL cell;
+                for(int i = 0; i < 8; i++) {
+                    int cx = x + corner[i][0], cy = y + corner[i][1], cz = z + corner[i][2];
+                    cell.p[i].x = cx;
+                    cell.p[i].y = cy;
+                    cell.p[i].z = cz;
+                    cell.val[i] = fieldAt(cx, cy, cz);
+                }
+                numTriangles += PolygoniseCube(cell, .35, triangles);
+            }
+    sink += numTriangles;
+}
+
+// Matrix stack ----------------------------------------------------------------
+
+#define TRANSFORM_STEPS 10000
+
+static void transformSetup(Benchmark * benchmark) {
+    model_view.clear();
+    projection.clear();
+    perspective(90, 1.25f, 60, 800);
+    lookAt(0, 180, 100, 0, 0, 0, 0, 1, 0);
+}
+
+// What drawing one object costs on the CPU: the same calls level1 makes.
+static void transformRun(Benchmark * benchmark) {
+    for(int i = 0; i < TRANSFORM_STEPS; i++) {
+        mvPushMatrix();
+        translatef(i, 2.0f, 3.0f);
+        rotate(0.0f, .01f * i, .5f);
+        scalef(1.5f);
+        sink += mvMatrix()[0] + mvpMatrix()[0];
+        mvPopMatrix();
+    }
+}
+
+// Instance transforms ---------------------------------------------------------
+
+#define INSTANCE_COUNT 10000
+
+struct InstanceState {
+    InstanceTransforms transforms;
+    vector<InstanceAttributes> attributes;
+};
+
+static void instanceSetup(Benchmark * benchmark) {
+    if(benchmark->state)
+        return;
+    InstanceState * state = new InstanceState();
+    for(int i = 0; i < INSTANCE_COUNT; i++)
+        state->transforms.Add(Vector3f(i, 2.0f, 3.0f), .01f * i, .5f, 1.5f, 0.0f);
+    state->attributes.resize(INSTANCE_COUNT);
+    benchmark->state = state;
+}
+
+// The model matrices of the matrix stack benchmark, built as one batch.
+static void instanceRun(Benchmark * benchmark) {
+    InstanceState * state = (InstanceState *) benchmark->state;
+    state->transforms.Build(Matrix4f::Identity(), &state->attributes[0]);
+    sink += state->attributes[INSTANCE_COUNT - 1].model[0];
+}
+
+// Simplex noise ---------------------------------------------------------------
+
+#define NOISE_SAMPLES 100000
+
+static void noiseRun(Benchmark * benchmark) {
+    float sum = 0.0f;
+    for(int i = 0; i < NOISE_SAMPLES; i++)
+        sum += octave_noise_3d(6.0f, .75f, 2.0f, i * .013f, i * .007f, i * .003f);
+    sink += sum;
+}
+
+// -----------------------------------------------------------------------------
+
+static Benchmark makeBenchmark(const char * name, void (*setup)(Benchmark *), void (*run)(Benchmark *), int items) {
+    Benchmark benchmark;
+    benchmark.name = name;
+    benchmark.setup = setup;
+    benchmark.run = run;
+    benchmark.items = items;
+    benchmark.state = NULL;
+    return benchmark;
+}
+
+static vector<Benchmark> allBenchmarks() {
+    vector<Benchmark> benchmarks;
+    addObjBenchmarks(benchmarks);
+    benchmarks.push_back(makeBenchmark("Fluid::Update", fluidSetup, fluidRun, FLUID_STEPS));
+    benchmarks.push_back(makeBenchmark("RenderDestructible::getGeometry", destructibleSetup, destructibleRun, DESTRUCTIBLE_STEPS));
+    benchmarks.push_back(makeBenchmark("PolygoniseCube", polygoniseSetup, polygoniseRun, POLYGONISE_GRID * POLYGONISE_GRID * POLYGONISE_GRID));
+    benchmarks.push_back(makeBenchmark("transform/push_translate_rotate_scale_pop", transformSetup, transformRun, TRANSFORM_STEPS));
+    benchmarks.push_back(makeBenchmark("InstanceTransforms::Build", instanceSetup, instanceRun, INSTANCE_COUNT));
+    benchmarks.push_back(makeBenchmark("octave_noise_3d", NULL, noiseRun, NOISE_SAMPLES));
+    return benchmarks;
+}
+
+static BenchmarkResult runBenchmark(Benchmark & benchmark, int warmup, int reps) {
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.items = benchmark.items;
+    for(int i = 0; i < warmup + reps; i++) {
+        if(benchmark.setup)
+            benchmark.setup(&benchmark);
+        Timer timer;
+        benchmark.run(&benchmark);
+        double seconds = timer.getSeconds();
+        if(i >= warmup)
+            result.seconds.push_back(seconds);
+    }
+    sort(result.seconds.begin(), result.seconds.end());
+    return result;
+}
+
+static double Percentile(const vector<double> & sorted, float p) {
+    int index = (int) (p * (sorted.size() - 1) + 0.5f);
+    return sorted[index];
+}
+
+static double Mean(const vector<double> & values) {
+    double sum = 0;
+    for(int i = 0; i < values.size(); i++)
+        sum += values[i];
+    return sum / values.size();
+}
+
+static double StandardDeviation(const vector<double> & values) {
+    double mean = Mean(values);
+    double sum = 0;
+    for(int i = 0; i < values.size(); i++)
+        sum += (values[i] - mean) * (values[i] - mean);
+    return values.size() > 1 ? sqrt(sum / (values.size() - 1)) : 0.0;
+}
+
+static void printResult(const BenchmarkResult & result) {
+    const vector<double> & s = result.seconds;
+    double median = Percentile(s, 0.5f);
+    printf("%-48s min %9.3fms  median %9.3fms  p90 %9.3fms  max %9.3fms  stddev %6.2f%%  %10.1fns/item\n",
+           result.name.c_str(), s.front() * 1000.0, median * 1000.0, Percentile(s, 0.9f) * 1000.0,
+           s.back() * 1000.0, 100.0 * StandardDeviation(s) / Mean(s), median * 1e9 / result.items);
+}
+
+static bool writeJson(const char * fileName, const vector<BenchmarkResult> & results, int warmup) {
+    FILE * file = fopen(fileName, "w");
+    if(!file) {
+        LOGE("Unable to write %s", fileName);
+        return false;
+    }
+    fprintf(file, "{\"warmup\":%d,\"benchmarks\":[", warmup);
+    for(int i = 0; i < results.size(); i++) {
+        const vector<double> & s = results[i].seconds;
+        fprintf(file, "%s\n{\"name\":\"%s\",\"repetitions\":%d,\"items\":%d,"
+                      "\"min_ms\":%.6f,\"median_ms\":%.6f,\"mean_ms\":%.6f,\"p90_ms\":%.6f,\"max_ms\":%.6f,\"stddev_ms\":%.6f,"
+                      "\"median_ns_per_item\":%.3f,\"samples_ms\":[",
+                i ? "," : "", results[i].name.c_str(), (int) s.size(), results[i].items,
+                s.front() * 1000.0, Percentile(s, 0.5f) * 1000.0, Mean(s) * 1000.0, Percentile(s, 0.9f) * 1000.0,
+                s.back() * 1000.0, StandardDeviation(s) * 1000.0, Percentile(s, 0.5f) * 1e9 / results[i].items);
+        for(int j = 0; j < s.size(); j++)
+            fprintf(file, "%s%.6f", j ? "," : "", s[j] * 1000.0);
+        fprintf(file, "]}");
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+static void Usage(const char * program) {
+    fprintf(stderr, "Usage: %s [--reps N] [--warmup N] [--filter STR] [--json FILE] [--list]\n", program);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int reps = 20;
+    int warmup = 3;
+    const char * filter = NULL;
+    const char * jsonFile = NULL;
+    bool list = false;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "--reps") == 0 && hasValue)
+            reps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--warmup") == 0 && hasValue)
+            warmup = max(0, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else if(strcmp(argv[i], "--json") == 0 && hasValue)
+            jsonFile = argv[++i];
+        else if(strcmp(argv[i], "--list") == 0)
+            list = true;
+        else
+            Usage(argv[0]);
+    }
+    if(reps <= 0)
+        Usage(argv[0]);
+
+    // No cache or loader: everything loads synchronously, straight from res/.
+    SetResourceCallback(ResourceCallback);
+    SetBinaryResourceCallback(BinaryResourceCallback, ReleaseBinaryResourceCallback);
+
+    vector<Benchmark> benchmarks = allBenchmarks();
+    vector<BenchmarkResult> results;
+    for(int i = 0; i < benchmarks.size(); i++) {
+        if(filter && !strstr(benchmarks[i].name.c_str(), filter))
+            continue;
+        if(list) {
+            printf("%s\n", benchmarks[i].name.c_str());
+            continue;
+        }
+        results.push_back(runBenchmark(benchmarks[i], warmup, reps));
+        printResult(results.back());
+        fflush(stdout);
+    }
+
+    if(jsonFile && !writeJson(jsonFile, results, warmup))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,94 @@
+// benchmark_stubs.cpp
+// nativeGraphics
+// Stands in for the parts of the engine the benchmark's kernels reference
+// but never use, so it links without common.cpp, RenderObject.cpp or any GL
+// library. Fluid and RenderDestructible are RenderObjects, so their vtables
+// still name the drawing functions below; calling any of them is a bug.
+
+#include <stdlib.h>
+
+#include "common.h"
+#include "Fluid.h"
+#include "RenderDestructible.h"
+#include "log.h"
+
+static void noGL(const char * function) {
+    LOGE("%s called in the benchmark, which has no GL", function);
+    abort();
+}
+
+// RenderObject ----------------------------------------------------------------
+
+RenderObject::RenderObject() {
+    numVertices = 0;
+    numIndices = 0;
+    pendingAssets = 0;
+    cull = true;
+    bounds[3] = -1.0f;
+}
+
+RenderObject::~RenderObject() {
+}
+
+void RenderObject::Submit(int instance) {
+    noGL("RenderObject::Submit");
+}
+
+void RenderObject::Execute(const DrawPacket & packet) {
+    noGL("RenderObject::Execute");
+}
+
+void RenderObject::RenderPass(int instance, GLfloat *buffer, int num) {
+    noGL("RenderObject::RenderPass");
+}
+
+// From FluidDraw.cpp and RenderDestructibleDraw.cpp ---------------------------
+
+void Fluid::Execute(const DrawPacket & packet) {
+    noGL("Fluid::Execute");
+}
+
+void Fluid::RenderPass(int instance, GLfloat *buffer, int num) {
+    noGL("Fluid::RenderPass");
+}
+
+void RenderDestructible::Execute(const DrawPacket & packet) {
+    noGL("RenderDestructible::Execute");
+}
+
+void RenderDestructible::RenderPass(int instance, GLfloat *buffer, int num) {
+    noGL("RenderDestructible::RenderPass");
+}
+
+// From common.cpp, without the resource cache ---------------------------------
+
+static void*(*resourceCallback)(const char *, int *, int *) = NULL;
+static void*(*binaryResourceCallback)(const char *, int *) = NULL;
+static void(*releaseBinaryResourceCallback)(void *, int) = NULL;
+
+void * loadResource(const char * fileName, int * width, int * height) {
+    return resourceCallback(fileName, width, height);
+}
+
+void SetResourceCallback(void*(*cb)(const char *, int *, int *)) {
+    resourceCallback = cb;
+}
+
+void * loadBinaryResource(const char * fileName, int * size) {
+    if(!binaryResourceCallback)
+        return NULL;
+    return binaryResourceCallback(fileName, size);
+}
+
+void releaseBinaryResource(void * data, int size) {
+    if(releaseBinaryResourceCallback)
+        releaseBinaryResourceCallback(data, size);
+}
+
+void SetBinaryResourceCallback(void*(*cb)(const char *, int *), void(*releasecb)(void *, int)) {
+    binaryResourceCallback = cb;
+    releaseBinaryResourceCallback = releasecb;
+}
+
+void SetResourceCache(const char * directory, bool(*statfunc)(const char *, long *, long *)) {
+}
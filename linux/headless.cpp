@@ -0,0 +1,327 @@
+// headless.cpp
+// nativeGraphics
+// Renders frames offscreen through EGL, for benchmarking and regression tests
+// on machines without a display (e.g. Mesa llvmpipe on CI).
+//
+// Usage: NativeGraphicsHeadless [options]
+//   --frames N        frames to render (default 300)
+//   --size WxH        framebuffer size (default 1000x800)
+//   --script FILE     scripted input, one event per line:
+//                       <frame> down|move|up <x> <y>
+//                       <frame> orient <roll> <pitch> <yaw>
+//   --timings FILE    write per-frame timings as CSV
+//   --dump DIR        write frames to DIR/frame_NNNNN.png
+//   --dump-every K    only dump every Kth frame (default 1)
+//   --preload         finish loading all assets before the first frame
+//   --frame-time S    simulate S seconds per frame, 0 for real time
+//                     (default 1/60, so runs are reproducible)
+//   --trace FILE      write a Chrome trace (chrome://tracing) of the last
+//                     PROFILER_FRAMES frames, with GPU times where supported
+//   --no-ubo          set shader constants with glUniform*, as on GLES2,
+//                     even where uniform buffers are supported
+//   --no-instancing   draw instances one at a time, as on GLES2, even where
+//                     hardware instancing is supported
+//   --no-precise-depth  keep 8-bit depth in the g buffer's alpha, as without
+//                     depth textures
+//   --no-tiled-lighting  draw each light's volume on its own
+//   --render-scale S  draw the g buffer and lights at S times the framebuffer
+//                     size, .5 to 1 (default 1)
+//   --target-fps N    adjust the render scale, up to S, to hold N frames per
+//                     second (default 0, fixed)
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "RenderState.h"
+#include "log.h"
+#include "Timer.h"
+#include "resource_callbacks.h"
+#include "pngHelper.h"
+
+using namespace std;
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+struct InputEvent {
+    int frame;
+    char type; // 'd'own, 'm'ove, 'u'p or 'o'rient
+    float value[3];
+};
+
+static bool LoadScript(const char * fileName, vector<InputEvent> & events) {
+    FILE * file = fopen(fileName, "r");
+    if(!file) {
+        LOGE("Unable to open script %s", fileName);
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    while(fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        char command[16];
+        InputEvent event = InputEvent();
+        int n = sscanf(line, "%d %15s %f %f %f", &event.frame, command, &event.value[0], &event.value[1], &event.value[2]);
+        if(n <= 0 || line[0] == '#')
+            continue;
+
+        event.type = command[0];
+        bool pointer = strcmp(command, "down") == 0 || strcmp(command, "move") == 0 || strcmp(command, "up") == 0;
+        if(!(pointer && n == 4) && !(strcmp(command, "orient") == 0 && n == 5)) {
+            LOGE("%s:%d: Can't parse '%s'", fileName, lineNumber, line);
+            fclose(file);
+            return false;
+        }
+        events.push_back(event);
+    }
+    fclose(file);
+    return true;
+}
+
+static void ApplyEvent(const InputEvent & event) {
+    switch(event.type) {
+        case 'd':
+            PointerDown(event.value[0], event.value[1]);
+            break;
+        case 'm':
+            PointerMove(event.value[0], event.value[1]);
+            break;
+        case 'u':
+            PointerUp(event.value[0], event.value[1]);
+            break;
+        case 'o':
+            UpdateOrientation(event.value[0], event.value[1], event.value[2]);
+            break;
+    }
+}
+
+// Makes a desktop GL context current without any window system surface,
+// preferring Mesa's surfaceless platform so no X server is needed.
+static bool CreateContext() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        LOGE("Unable to initialize EGL.");
+        return false;
+    }
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        LOGE("EGL implementation does not support desktop OpenGL.");
+        return false;
+    }
+
+    // Any config will do since we render to an FBO, but the default
+    // EGL_SURFACE_TYPE (window) rules out every surfaceless one.
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if(!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+        LOGE("No suitable EGL config.");
+        return false;
+    }
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        LOGE("Unable to create a surfaceless EGL context (0x%x).", eglGetError());
+        return false;
+    }
+
+    LOGI("EGL %d.%d, %s", major, minor, (const char *) glGetString(GL_RENDERER));
+    return true;
+}
+
+// Stands in for the window's framebuffer.
+static GLuint CreateFrameBuffer(int width, int height) {
+    GLuint frameBuffer, colorBuffer;
+    glGenFramebuffers(1, &frameBuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOGE("Offscreen framebuffer is incomplete.");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    checkGlError("CreateFrameBuffer");
+    return frameBuffer;
+}
+
+static void DumpFrame(GLuint frameBuffer, int width, int height, const char * directory, int frame) {
+    vector<unsigned char> pixels(width * height * 4);
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    checkGlError("DumpFrame");
+
+    char fileName[512];
+    snprintf(fileName, sizeof(fileName), "%s/frame_%05d.png", directory, frame);
+    pngWriteFile(fileName, &pixels[0], width, height);
+}
+
+static float Percentile(const vector<float> & sorted, float p) {
+    int index = (int) (p * (sorted.size() - 1) + 0.5f);
+    return sorted[index];
+}
+
+static void Usage(const char * program) {
+    fprintf(stderr, "Usage: %s [--frames N] [--size WxH] [--script FILE] [--timings FILE]\n"
+                    "       [--dump DIR] [--dump-every K] [--preload] [--frame-time S]\n"
+                    "       [--trace FILE] [--no-ubo] [--no-instancing]\n"
+                    "       [--no-precise-depth] [--no-tiled-lighting]\n"
+                    "       [--render-scale S] [--target-fps N]\n", program);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int numFrames = 300;
+    int width = 1000, height = 800;
+    const char * scriptFile = NULL;
+    const char * timingsFile = NULL;
+    const char * dumpDirectory = NULL;
+    const char * traceFile = NULL;
+    int dumpEvery = 1;
+    bool preload = false;
+    float frameTime = 1.0f / 60.0f;
+    bool uniformBuffers = true;
+    bool instancing = true;
+    bool preciseDepth = true;
+    bool tiledLighting = true;
+    float renderScale = 1.0f;
+    float targetFrameRate = 0.0f;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "--frames") == 0 && hasValue)
+            numFrames = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--size") == 0 && hasValue) {
+            if(sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+                Usage(argv[0]);
+        }
+        else if(strcmp(argv[i], "--script") == 0 && hasValue)
+            scriptFile = argv[++i];
+        else if(strcmp(argv[i], "--timings") == 0 && hasValue)
+            timingsFile = argv[++i];
+        else if(strcmp(argv[i], "--dump") == 0 && hasValue)
+            dumpDirectory = argv[++i];
+        else if(strcmp(argv[i], "--dump-every") == 0 && hasValue)
+            dumpEvery = max(1, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--preload") == 0)
+            preload = true;
+        else if(strcmp(argv[i], "--frame-time") == 0 && hasValue)
+            frameTime = max(0.0f, (float) atof(argv[++i]));
+        else if(strcmp(argv[i], "--trace") == 0 && hasValue)
+            traceFile = argv[++i];
+        else if(strcmp(argv[i], "--no-ubo") == 0)
+            uniformBuffers = false;
+        else if(strcmp(argv[i], "--no-instancing") == 0)
+            instancing = false;
+        else if(strcmp(argv[i], "--no-precise-depth") == 0)
+            preciseDepth = false;
+        else if(strcmp(argv[i], "--no-tiled-lighting") == 0)
+            tiledLighting = false;
+        else if(strcmp(argv[i], "--render-scale") == 0 && hasValue)
+            renderScale = (float) atof(argv[++i]);
+        else if(strcmp(argv[i], "--target-fps") == 0 && hasValue)
+            targetFrameRate = max(0.0f, (float) atof(argv[++i]));
+        else
+            Usage(argv[0]);
+    }
+    if(numFrames <= 0 || width <= 0 || height <= 0)
+        Usage(argv[0]);
+
+    vector<InputEvent> events;
+    if(scriptFile && !LoadScript(scriptFile, events))
+        return 1;
+
+    if(!CreateContext())
+        return 1;
+    glewInit(); // Without GLX this reports an error, but GL entry points still load
+
+    srand(0); // Same enemy spawns every run
+    RegisterResourceCallbacks();
+    SetUniformBuffers(uniformBuffers);
+    SetInstancing(instancing);
+    SetPreciseDepth(preciseDepth);
+    SetTiledLighting(tiledLighting);
+    SetRenderScale(renderScale);
+    SetTargetFrameRate(targetFrameRate);
+    Setup(width, height);
+    GLuint frameBuffer = CreateFrameBuffer(width, height);
+    setFrameBuffer(frameBuffer); // After Setup, which resets it
+    SetFixedFrameTime(frameTime);
+    if(traceFile)
+        profiler.Enable(true);
+
+    if(preload) {
+        while(assetLoader->NumPending() > 0) {
+            assetLoader->Update(1.0f);
+            usleep(1000);
+        }
+    }
+
+    FILE * timings = timingsFile ? fopen(timingsFile, "w") : NULL;
+    if(timings)
+        fprintf(timings, "frame,milliseconds,pending_assets,state_calls,state_calls_skipped\n");
+
+    vector<float> frameTimes;
+    long stateCalls = 0, stateCallsSkipped = 0;
+    int nextEvent = 0;
+    Timer total;
+    for(int frame = 0; frame < numFrames; frame++) {
+        for(; nextEvent < events.size() && events[nextEvent].frame <= frame; nextEvent++)
+            ApplyEvent(events[nextEvent]);
+
+        // glFinish so the time includes the GPU (or llvmpipe) work
+        Timer timer;
+        RenderFrame();
+        glFinish();
+        float milliseconds = timer.getSeconds() * 1000.0f;
+        frameTimes.push_back(milliseconds);
+        stateCalls += renderState.Issued();
+        stateCallsSkipped += renderState.Skipped();
+
+        if(timings)
+            fprintf(timings, "%d,%.3f,%d,%d,%d\n", frame, milliseconds, assetLoader->NumPending(),
+                    renderState.Issued(), renderState.Skipped());
+        if(dumpDirectory && frame % dumpEvery == 0)
+            DumpFrame(frameBuffer, width, height, dumpDirectory, frame);
+    }
+    float totalSeconds = total.getSeconds();
+    if(timings)
+        fclose(timings);
+    if(traceFile && !profiler.WriteChromeTrace(traceFile))
+        return 1;
+
+    sort(frameTimes.begin(), frameTimes.end());
+    float sum = 0;
+    for(int i = 0; i < frameTimes.size(); i++)
+        sum += frameTimes[i];
+    printf("frames %d  total %.2fs  mean %.2fms  min %.2fms  median %.2fms  p95 %.2fms  max %.2fms\n",
+           numFrames, totalSeconds, sum / numFrames, frameTimes.front(),
+           Percentile(frameTimes, 0.5f), Percentile(frameTimes, 0.95f), frameTimes.back());
+    printf("GL state calls per frame: %.1f issued, %.1f skipped as redundant\n",
+           stateCalls / (float) numFrames, stateCallsSkipped / (float) numFrames);
+    return 0;
+}
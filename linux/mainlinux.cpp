@@ -8,15 +8,10 @@
     #include <GL/glut.h>
 #endif
 #include <stdio.h>
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <string.h>
 
 #include "common.h"
 #include "log.h"
-#include "jpegHelper.h"
-#include "pngHelper.h"
+#include "resource_callbacks.h"
 
 using namespace std;
 
@@ -80,61 +75,6 @@ void MouseMotionCallback(int x, int y) {
     PointerMove((float) x / (float)gWindowSizeX, (float) y / (float)gWindowSizeY);
 }
 
-bool checkExt(const char * cfileName, const char * ext) {
-    char * fileName = strdup(cfileName);
-    strtok(fileName, ".");
-    char * fileExt = strtok(NULL, ".");
-    bool match = strcmp(fileExt, ext) == 0;
-    free(fileName);
-    return match;
-}
-
-char * stringResourceCallback(const char * fileName) {
-    const char * path = "../res/raw/";
-    char * filePath = (char *) malloc(strlen(path) + strlen(fileName) + 1);
-    strcpy(filePath, path);
-    strcat(filePath, fileName);
-    ifstream file(filePath);
-    free(filePath);
-    if(!file.is_open()) {
-        printf("Unable to open file %s\n", fileName);
-        return NULL;
-    }
-
-    string returnStr;
-/* OpenGL ES requires precision identifiers in shaders, while regular OpenGL
-   while not compile with precision specifiers. We get around this by skippinng
-   the first line of GLSL files. */
-    if(checkExt(fileName, "glsl"))
-        getline(file, returnStr);
-    getline(file, returnStr, '\0');
-    file.close();
-
-    return strdup(returnStr.c_str());
-}
-
-void * ResourceCallback(const char * fileName, int * width, int * height) {
-    if(checkExt(fileName, "jpg") || checkExt(fileName, "jpeg")) {
-        if(width && height)
-            return jpegResourceCallback(fileName, *width, *height);
-        LOGI("You should probably have passed width and height here.");
-        int temp1, temp2;
-        return jpegResourceCallback(fileName, temp1, temp2);
-    }
-    if(checkExt(fileName, "png")) {
-        if(width && height)
-            return pngResourceCallback(fileName, *width, *height);
-        LOGI("You should probably have passed width and height here.");
-        int temp1, temp2;
-        return pngResourceCallback(fileName, temp1, temp2);
-    }
-    if(width)
-        *width = -1;
-    if(height)
-        *height = -1;
-    return stringResourceCallback(fileName);
-}
-
 int main(int argc, char** argv) {
 
     // Initialize GLUT.
@@ -159,7 +99,7 @@ int main(int argc, char** argv) {
         }
     }
 
-    SetResourceCallback(ResourceCallback);
+    RegisterResourceCallbacks();
     Setup(gWindowSizeX, gWindowSizeY);
 
     glutDisplayFunc(DisplayCallback);
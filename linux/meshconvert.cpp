@@ -0,0 +1,51 @@
+// meshconvert.cpp
+// nativeGraphics
+// Offline converter from obj files to the binary mesh format (see mesh_format.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "obj_parser.h"
+#include "mesh_format.h"
+
+static char * readFile(const char * path) {
+    FILE * file = fopen(path, "rb");
+    if(!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+
+    char * buffer = (char *) malloc(length + 1);
+    if(fread(buffer, 1, length, file) != (size_t) length) {
+        free(buffer);
+        fclose(file);
+        return NULL;
+    }
+    buffer[length] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+int main(int argc, char** argv) {
+    if(argc != 3) {
+        printf("Usage: %s input.obj output.bin\n", argv[0]);
+        return 1;
+    }
+
+    char * objString = readFile(argv[1]);
+    if(!objString) {
+        printf("Unable to read %s\n", argv[1]);
+        return 1;
+    }
+
+    int numVertices, numIndices;
+    unsigned int * indices;
+    float * vertexBuffer = getIndexedBuffer(objString, numVertices, indices, numIndices, true, true);
+    bool success = writeMeshFile(argv[2], vertexBuffer, numVertices, 3+3+2, indices, numIndices);
+
+    free(vertexBuffer);
+    free(indices);
+    free(objString);
+    return success ? 0 : 1;
+}
@@ -4,7 +4,7 @@
 
 #include <png.h>
 
-void * pngResourceCallback(const char * file_name, int & width, int & height) {
+static void * pngResourceCallback(const char * file_name, int & width, int & height) {
     
     const char * path = "../res/drawable/";
     char * filePath = (char *) malloc(strlen(path) + strlen(file_name) + 1);
@@ -146,3 +146,44 @@ void * pngResourceCallback(const char * file_name, int & width, int & height) {
     fclose(fp);
     return image_data;
 }
+
+// Writes tightly packed RGBA pixels to a PNG. Rows are given bottom-up, as
+// returned by glReadPixels.
+static bool pngWriteFile(const char * file_name, const unsigned char * pixels, int width, int height) {
+    FILE * fp = fopen(file_name, "wb");
+    if(!fp) {
+        printf("Can't open %s for writing\n", file_name);
+        return false;
+    }
+
+    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+    if (!info_ptr)
+    {
+        fprintf(stderr, "error: could not create PNG write structs.\n");
+        png_destroy_write_struct(&png_ptr, (png_infopp) NULL);
+        fclose(fp);
+        return false;
+    }
+
+    // the code in this if statement gets called if libpng encounters an error
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        fprintf(stderr, "error from libpng\n");
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        return false;
+    }
+
+    png_init_io(png_ptr, fp);
+    png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png_ptr, info_ptr);
+
+    for (int i = height - 1; i >= 0; i--)
+        png_write_row(png_ptr, (png_bytep) (pixels + i * width * 4));
+
+    png_write_end(png_ptr, NULL);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,120 @@
+// resource_callbacks.cpp
+// nativeGraphics
+// Loads resources from res/ for the Linux builds
+
+#include "resource_callbacks.h"
+
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "log.h"
+#include "jpegHelper.h"
+#include "pngHelper.h"
+
+using namespace std;
+
+// Called from asset loading threads, so must not use strtok.
+static bool checkExt(const char * fileName, const char * ext) {
+    const char * fileExt = strrchr(fileName, '.');
+    return fileExt != NULL && strcmp(fileExt + 1, ext) == 0;
+}
+
+static char * stringResourceCallback(const char * fileName) {
+    const char * path = "../res/raw/";
+    char * filePath = (char *) malloc(strlen(path) + strlen(fileName) + 1);
+    strcpy(filePath, path);
+    strcat(filePath, fileName);
+    ifstream file(filePath);
+    free(filePath);
+    if(!file.is_open()) {
+        printf("Unable to open file %s\n", fileName);
+        return NULL;
+    }
+
+    string returnStr;
+/* OpenGL ES requires precision identifiers in shaders, while regular OpenGL
+   while not compile with precision specifiers. We get around this by skippinng
+   the first line of GLSL files. */
+    if(checkExt(fileName, "glsl"))
+        getline(file, returnStr);
+    getline(file, returnStr, '\0');
+    file.close();
+
+    return strdup(returnStr.c_str());
+}
+
+void * ResourceCallback(const char * fileName, int * width, int * height) {
+    if(checkExt(fileName, "jpg") || checkExt(fileName, "jpeg")) {
+        if(width && height)
+            return jpegResourceCallback(fileName, *width, *height);
+        LOGI("You should probably have passed width and height here.");
+        int temp1, temp2;
+        return jpegResourceCallback(fileName, temp1, temp2);
+    }
+    if(checkExt(fileName, "png")) {
+        if(width && height)
+            return pngResourceCallback(fileName, *width, *height);
+        LOGI("You should probably have passed width and height here.");
+        int temp1, temp2;
+        return pngResourceCallback(fileName, temp1, temp2);
+    }
+    if(width)
+        *width = -1;
+    if(height)
+        *height = -1;
+    return stringResourceCallback(fileName);
+}
+
+// Memory-maps a file from res/raw, so binary resources are never copied.
+void * BinaryResourceCallback(const char * fileName, int * size) {
+    string filePath = string("../res/raw/") + fileName;
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) < 0 || fileStat.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void * data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return NULL;
+
+    *size = fileStat.st_size;
+    return data;
+}
+
+void ReleaseBinaryResourceCallback(void * data, int size) {
+    munmap(data, size);
+}
+
+// Size and modification time of a resource, for keying the resource cache.
+bool ResourceStatCallback(const char * fileName, long * size, long * mtime) {
+    const char * paths[] = {"../res/raw/", "../res/drawable/"};
+    for(int i = 0; i < 2; i++) {
+        struct stat fileStat;
+        if(stat((string(paths[i]) + fileName).c_str(), &fileStat) == 0) {
+            *size = fileStat.st_size;
+            *mtime = fileStat.st_mtime;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RegisterResourceCallbacks() {
+    SetResourceCallback(ResourceCallback);
+    SetBinaryResourceCallback(BinaryResourceCallback, ReleaseBinaryResourceCallback);
+    SetResourceCache("../cache", ResourceStatCallback);
+}
@@ -0,0 +1,17 @@
+// resource_callbacks.h
+// nativeGraphics
+// Loads resources from res/ for the Linux builds
+
+#ifndef __nativeGraphics__resource_callbacks__
+#define __nativeGraphics__resource_callbacks__
+
+// Paths are relative to linux/, which the executables must be run from.
+void * ResourceCallback(const char * fileName, int * width, int * height);
+void * BinaryResourceCallback(const char * fileName, int * size);
+void ReleaseBinaryResourceCallback(void * data, int size);
+bool ResourceStatCallback(const char * fileName, long * size, long * mtime);
+
+// Installs all of the above with common, along with the resource cache.
+void RegisterResourceCallbacks();
+
+#endif // __nativeGraphics__resource_callbacks__
@@ -0,0 +1,82 @@
+precision mediump float;       	// Set the default precision to medium. We don't need as high of a precision in the fragment shader.
+
+// Tonemaps the light buffer to the display. With UPSAMPLE defined it's
+// smaller than the display, and each pixel blends the four nearest texels
+// bilinearly, but leaves out those whose depth is far from the nearest
+// one's, so light doesn't bleed across the edges of objects.
+
+#if defined(GL_ES) && defined(GL_FRAGMENT_PRECISION_HIGH)
+#define DEPTH_P highp
+#else
+#define DEPTH_P
+#endif
+
+// Light below this passes through unchanged, and above it rolls off
+// towards 1 instead of clipping
+#define TONEMAP_KNEE 0.75
+// Texels further than this fraction of the nearest one's view distance away
+// get no weight
+#define DEPTH_TOLERANCE 0.1
+
+uniform sampler2D u_LightBuffer;
+uniform DEPTH_P vec2 u_SourceSize;  // Of the light buffer, in texels
+uniform DEPTH_P vec2 u_TexelSize;   // 1 / display size
+
+#ifdef UPSAMPLE
+uniform sampler2D u_gBuffer; // R, G, B, Depth_MVP
+#ifdef PRECISE_DEPTH
+uniform DEPTH_P sampler2D u_gDepth; // Depth buffer, 0 (near) to 1 (far)
+#endif
+uniform DEPTH_P vec2 u_DepthParams; // View distance is y / (NDC depth + x)
+
+DEPTH_P float viewDistance(DEPTH_P vec2 texCoord) {
+#ifdef PRECISE_DEPTH
+    DEPTH_P float MVP_Z = texture2D(u_gDepth, texCoord).x * 2.0 - 1.0;
+#else
+    DEPTH_P float MVP_Z = texture2D(u_gBuffer, texCoord).w;
+#endif
+    return u_DepthParams.y / (MVP_Z + u_DepthParams.x);
+}
+
+vec3 upsample() {
+    // Position in the light buffer, relative to the center of the texel
+    // below and to the left
+    DEPTH_P vec2 position = gl_FragCoord.xy * u_TexelSize * u_SourceSize - 0.5;
+    DEPTH_P vec2 base = floor(position);
+    DEPTH_P vec2 f = position - base;
+    DEPTH_P vec2 texel = 1.0 / u_SourceSize;
+    DEPTH_P vec2 corner = (base + 0.5) * texel;
+
+    DEPTH_P vec2 coords[4];
+    coords[0] = corner;
+    coords[1] = corner + vec2(texel.x, 0.0);
+    coords[2] = corner + vec2(0.0, texel.y);
+    coords[3] = corner + texel;
+    vec4 bilinear = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+
+    DEPTH_P float reference = viewDistance((floor(position + 0.5) + 0.5) * texel);
+
+    vec3 total = vec3(0.0);
+    float weights = 0.0;
+    for(int i = 0; i < 4; i++) {
+        DEPTH_P float difference = abs(viewDistance(coords[i]) - reference);
+        float weight = bilinear[i] * clamp(1.0 - difference / (DEPTH_TOLERANCE * reference), 0.0, 1.0);
+        total += weight * texture2D(u_LightBuffer, coords[i]).rgb;
+        weights += weight;
+    }
+    // The nearest texel always has some weight
+    return total / weights;
+}
+#endif
+
+void main() {
+#ifdef UPSAMPLE
+    vec3 light = upsample();
+#else
+    vec3 light = texture2D(u_LightBuffer, gl_FragCoord.xy * u_TexelSize).rgb;
+#endif
+    light /= LIGHT_SCALE; // Undoes the light shaders' scale, see RenderPipeline.h
+    vec3 over = max(light - TONEMAP_KNEE, 0.0);
+    light = min(light, TONEMAP_KNEE) + (1.0 - TONEMAP_KNEE) * (1.0 - exp(-over / (1.0 - TONEMAP_KNEE)));
+    gl_FragColor = vec4(light, 1.0);
+}
@@ -0,0 +1,26 @@
+precision mediump float;       	// Set the default precision to medium. We don't need as high of a precision in the fragment shader.
+
+// Packs depth into RGBA8 so it can be read back where depth textures can't.
+// Decode with r / 255 + g / 255^2 + b / 255^3.
+
+#if defined(GL_ES) && defined(GL_FRAGMENT_PRECISION_HIGH)
+#define DEPTH_P highp
+#else
+#define DEPTH_P
+#endif
+
+uniform DEPTH_P sampler2D u_gDepth; // Depth buffer, 0 (near) to 1 (far)
+
+uniform DEPTH_P vec2 u_Offset;    // Of the block being read, in pixels
+uniform DEPTH_P vec2 u_TexelSize; // 1 / g buffer size
+
+void main() {
+    DEPTH_P float depth = texture2D(u_gDepth, (gl_FragCoord.xy + u_Offset) * u_TexelSize).x;
+    if(depth >= 1.0) {
+        gl_FragColor = vec4(1.0); // Decodes to more than 1
+        return;
+    }
+    DEPTH_P vec3 encoded = fract(depth * vec3(1.0, 255.0, 65025.0));
+    encoded.xy -= encoded.yz / 255.0;
+    gl_FragColor = vec4(encoded, 1.0);
+}
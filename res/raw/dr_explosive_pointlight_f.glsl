@@ -1,8 +1,17 @@
 precision mediump float;       	// Set the default precision to medium. We don't need as high of a precision in the fragment shader.
 
+#if defined(GL_ES) && defined(GL_FRAGMENT_PRECISION_HIGH)
+#define DEPTH_P highp
+#else
+#define DEPTH_P
+#endif
+
 uniform sampler2D u_gBuffer; // R, G, B, Depth_MVP
+#ifdef PRECISE_DEPTH
+uniform DEPTH_P sampler2D u_gDepth; // Depth buffer, 0 (near) to 1 (far)
+#endif
 
-uniform mat4 u_pT_Matrix;
+uniform DEPTH_P mat4 u_pT_Matrix;
 
 uniform int u_FragWidth;
 uniform int u_FragHeight;
@@ -12,21 +21,26 @@ uniform float u_Brightness;
 
 varying vec3 v_mvLightPos;
 
-vec2 samplePoint = vec2(gl_FragCoord.x / float(u_FragWidth), gl_FragCoord.y / float(u_FragHeight));
+vec2 samplePoint; // Set by main
 
 // Reconstruct MV position from MVP position and inverse P matrix.
 vec3 mvPos() {
+#ifdef PRECISE_DEPTH
+    DEPTH_P float MVP_Z = texture2D(u_gDepth, samplePoint).x * 2.0 - 1.0;
+#else
     float MVP_Z = texture2D(u_gBuffer, samplePoint).w;
-    vec4 mvpPos = vec4(samplePoint * 2.0 - 1.0, MVP_Z, 1.0);
-    vec4 mvPos_hom = u_pT_Matrix * mvpPos;
+#endif
+    DEPTH_P vec4 mvpPos = vec4(samplePoint * 2.0 - 1.0, MVP_Z, 1.0);
+    DEPTH_P vec4 mvPos_hom = u_pT_Matrix * mvpPos;
     return mvPos_hom.xyz / mvPos_hom.w;
 }
 
 void main() {
+    samplePoint = vec2(gl_FragCoord.x / float(u_FragWidth), gl_FragCoord.y / float(u_FragHeight));
 
     vec3 delta = v_mvLightPos - mvPos();
 	float distsq = delta.x * delta.x + delta.y * delta.y + delta.z * delta.z; 
 	vec3 lightColor = u_Color * (u_Brightness / pow(distsq, 1.5) - 1.0);
-    gl_FragColor = vec4(lightColor * texture2D(u_gBuffer, samplePoint).rgb, 1.0);
+    gl_FragColor = vec4(clamp(lightColor * texture2D(u_gBuffer, samplePoint).rgb, 0.0, LIGHT_MAX) * LIGHT_SCALE, 1.0);
 	
 }
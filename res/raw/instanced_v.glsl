@@ -0,0 +1,28 @@
+
+uniform mat4 u_MVMatrix;		// The model-view matrix shared by all instances.
+uniform mat4 u_PMatrix;
+
+attribute mat4 a_InstanceMatrix;	// Per instance: its own model matrix, applied before u_MVMatrix.
+attribute float a_InstanceTime;		// Per instance: animation time.
+
+attribute vec2 a_TexCoordinate;
+varying vec2 v_TexCoordinate;
+
+attribute vec3 a_Normal;
+varying vec3 v_Normal;
+
+attribute vec4 a_Position;
+varying float depth_MVP;
+varying float v_Time;
+
+void main() {
+	mat4 modelView = u_MVMatrix * a_InstanceMatrix;
+
+	v_TexCoordinate = a_TexCoordinate;
+	v_Normal = normalize(vec3(modelView * vec4(a_Normal, 0.0)));
+	v_Time = a_InstanceTime;
+
+	vec4 v_MVP_Position = u_PMatrix * (modelView * a_Position);
+	gl_Position = v_MVP_Position;
+	depth_MVP = v_MVP_Position.z / v_MVP_Position.w;
+}
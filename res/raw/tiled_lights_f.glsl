@@ -0,0 +1,85 @@
+precision mediump float;       	// Set the default precision to medium. We don't need as high of a precision in the fragment shader.
+
+// Shades up to 8 lights at once over screen tiles, reading the g buffer once.
+// Each falloff matches the shader the light would otherwise be drawn with.
+
+#if defined(GL_ES) && defined(GL_FRAGMENT_PRECISION_HIGH)
+#define DEPTH_P highp
+#else
+#define DEPTH_P
+#endif
+
+uniform sampler2D u_gBuffer; // R, G, B, Depth_MVP
+#ifdef PRECISE_DEPTH
+uniform DEPTH_P sampler2D u_gDepth; // Depth buffer, 0 (near) to 1 (far)
+#endif
+
+uniform DEPTH_P mat4 u_pT_Matrix;
+
+uniform int u_FragWidth;
+uniform int u_FragHeight;
+
+uniform int u_NumLights;
+uniform DEPTH_P vec4 u_LightPosition[8];  // MV position, then falloff: 0 point, 1 saturating, 2 explosive, 3 spot
+uniform DEPTH_P vec4 u_LightColor[8];     // R, G, B, then brightness
+uniform DEPTH_P vec4 u_LightDirection[8]; // MV y axis of the light
+uniform DEPTH_P vec4 u_LightVolume[8];    // 0 unbounded, 1 sphere (radius), 2 cone along -y (length, slope), then reach
+
+vec2 samplePoint; // Set by main
+
+// Reconstruct MV position from MVP position and inverse P matrix.
+vec3 mvPos() {
+#ifdef PRECISE_DEPTH
+    DEPTH_P float MVP_Z = texture2D(u_gDepth, samplePoint).x * 2.0 - 1.0;
+#else
+    float MVP_Z = texture2D(u_gBuffer, samplePoint).w;
+#endif
+    DEPTH_P vec4 mvpPos = vec4(samplePoint * 2.0 - 1.0, MVP_Z, 1.0);
+    DEPTH_P vec4 mvPos_hom = u_pT_Matrix * mvpPos;
+    return mvPos_hom.xyz / mvPos_hom.w;
+}
+
+void main() {
+    samplePoint = vec2(gl_FragCoord.x / float(u_FragWidth), gl_FragCoord.y / float(u_FragHeight));
+    DEPTH_P vec3 position = mvPos();
+    vec3 albedo = texture2D(u_gBuffer, samplePoint).rgb;
+
+    vec3 total = vec3(0.0);
+    for(int i = 0; i < 8; i++) {
+        if(i >= u_NumLights)
+            break;
+
+        DEPTH_P vec3 delta = u_LightPosition[i].xyz - position;
+        DEPTH_P float distsq = dot(delta, delta);
+        DEPTH_P vec4 volume = u_LightVolume[i];
+        if(distsq > volume.w * volume.w)
+            continue; // Too far for the falloff to show
+        if(volume.x > 1.5) {
+            // The apex is at the light, and the axis is -direction
+            DEPTH_P float along = dot(delta, u_LightDirection[i].xyz);
+            DEPTH_P float reach = along * volume.z;
+            if(along < 0.0 || along > volume.y || distsq - along * along > reach * reach)
+                continue;
+        } else if(volume.x > 0.5 && distsq > volume.y * volume.y)
+            continue;
+
+        float falloff = u_LightPosition[i].w;
+        vec3 color = u_LightColor[i].rgb;
+        DEPTH_P float brightness = u_LightColor[i].w;
+        vec3 light;
+        if(falloff < 0.5) {
+            light = min(brightness / distsq, 1.5) * color * albedo;
+        } else if(falloff < 1.5) {
+            light = color * brightness / distsq - .2;
+        } else if(falloff < 2.5) {
+            light = color * (brightness / pow(distsq, 1.5) - 1.0) * albedo;
+        } else {
+            float angle = abs(dot(u_LightDirection[i].xyz, normalize(delta)));
+            float spotEffect = min(2.0 * pow(angle, 10.0), 2.0);
+            light = min(brightness * spotEffect / distsq, 2.0) * color * albedo;
+        }
+        // As each would be drawn on its own
+        total += clamp(light, 0.0, LIGHT_MAX);
+    }
+    gl_FragColor = vec4(total * LIGHT_SCALE, 1.0);
+}